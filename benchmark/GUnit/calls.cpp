@@ -0,0 +1,49 @@
+//
+// Copyright (c) 2016-2017 Kris Jusiak (kris at jusiak dot net)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//
+#include <GUnit.h>
+#include <chrono>
+#include <iostream>
+#include "example.h"
+
+#if !defined(BENCHMARK_CALLS)
+#define BENCHMARK_CALLS 10000
+#endif
+
+GTEST(example, "[calls]") {
+  using namespace testing;
+  std::tie(sut, mocks) = make<SUT, NiceGMock>();
+
+  SHOULD("measure mocked calls per second") {
+    EXPECT_CALL(mock<interface1>(), (f1)(42)).WillRepeatedly(Return(true));
+    EXPECT_CALL(mock<interface2>(), (f2_1)()).Times(BENCHMARK_CALLS);
+    EXPECT_CALL(mock<interface3>(), (f3)(0, 1, 2)).Times(BENCHMARK_CALLS);
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (auto i = 0; i < BENCHMARK_CALLS; ++i) {
+      sut->test();
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::cout << "[ GUnit    ] " << static_cast<long long>(3 * BENCHMARK_CALLS / elapsed) << " calls/sec" << std::endl;
+  }
+}
+
+GTEST(example, "[stub calls]") {
+  using namespace testing;
+  std::tie(sut, mocks) = make<SUT, StubGMock>();
+
+  SHOULD("measure stubbed calls per second") {
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (auto i = 0; i < BENCHMARK_CALLS; ++i) {
+      sut->test();
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::cout << "[ GUnit    ] " << static_cast<long long>(3 * BENCHMARK_CALLS / elapsed) << " stubbed calls/sec" << std::endl;
+  }
+}
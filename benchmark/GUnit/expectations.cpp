@@ -0,0 +1,70 @@
+//
+// Copyright (c) 2016-2017 Kris Jusiak (kris at jusiak dot net)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//
+// Compile time and object size of EXPECT_CALL/ON_CALL heavy test
+//
+#include <GUnit.h>
+#include "interface4.h"
+
+GTEST("expectations") {
+  using namespace testing;
+  StrictGMock<interface4> mock;
+  auto& i = mock.object();
+
+  SHOULD("handle state queries") {
+    EXPECT_CALL(mock, (is_connection_established)()).WillOnce(Return(true));
+    EXPECT_CALL(mock, (is_authentication_required)()).WillOnce(Return(false));
+    EXPECT_CALL(mock, (is_transaction_in_progress)()).WillOnce(Return(true));
+    EXPECT_CALL(mock, (get_number_of_pending_requests)()).WillOnce(Return(1));
+    EXPECT_CALL(mock, (get_number_of_retries_left)()).WillOnce(Return(2));
+    EXPECT_CALL(mock, (get_maximum_payload_size_in_bytes)()).WillOnce(Return(3));
+
+    EXPECT_TRUE(i.is_connection_established());
+    EXPECT_FALSE(i.is_authentication_required());
+    EXPECT_TRUE(i.is_transaction_in_progress());
+    EXPECT_EQ(1, i.get_number_of_pending_requests());
+    EXPECT_EQ(2, i.get_number_of_retries_left());
+    EXPECT_EQ(3, i.get_maximum_payload_size_in_bytes());
+  }
+
+  SHOULD("handle default state queries") {
+    ON_CALL(mock, (is_connection_established)()).WillByDefault(Return(true));
+    ON_CALL(mock, (is_authentication_required)()).WillByDefault(Return(true));
+    ON_CALL(mock, (is_transaction_in_progress)()).WillByDefault(Return(true));
+    ON_CALL(mock, (get_number_of_pending_requests)()).WillByDefault(Return(4));
+    ON_CALL(mock, (get_number_of_retries_left)()).WillByDefault(Return(5));
+    ON_CALL(mock, (get_maximum_payload_size_in_bytes)()).WillByDefault(Return(6));
+  }
+
+  SHOULD("handle events") {
+    EXPECT_CALL(mock, (on_connection_established)(1));
+    EXPECT_CALL(mock, (on_connection_lost)(2));
+    EXPECT_CALL(mock, (on_request_received)(3, "request"));
+    EXPECT_CALL(mock, (on_response_received)(4, "response"));
+    EXPECT_CALL(mock, (on_transaction_committed)(5, "commit"));
+    EXPECT_CALL(mock, (on_transaction_rolled_back)(6, "rollback"));
+
+    i.on_connection_established(1);
+    i.on_connection_lost(2);
+    i.on_request_received(3, "request");
+    i.on_response_received(4, "response");
+    i.on_transaction_committed(5, "commit");
+    i.on_transaction_rolled_back(6, "rollback");
+  }
+
+  SHOULD("handle any events") {
+    EXPECT_CALL(mock, (on_connection_established)(_)).Times(AnyNumber());
+    EXPECT_CALL(mock, (on_connection_lost)(_)).Times(AnyNumber());
+    EXPECT_CALL(mock, (on_request_received)(_, _)).Times(AnyNumber());
+    EXPECT_CALL(mock, (on_response_received)(_, _)).Times(AnyNumber());
+    EXPECT_CALL(mock, (on_transaction_committed)(_, _)).Times(AnyNumber());
+    EXPECT_CALL(mock, (on_transaction_rolled_back)(_, _)).Times(AnyNumber());
+
+    i.on_request_received(7, "request");
+    i.on_response_received(7, "response");
+  }
+}
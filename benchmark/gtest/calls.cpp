@@ -0,0 +1,45 @@
+//
+// Copyright (c) 2016-2017 Kris Jusiak (kris at jusiak dot net)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include "example.h"
+#include "gtest/mocks/mock_interface1.h"
+#include "gtest/mocks/mock_interface2.h"
+#include "gtest/mocks/mock_interface3.h"
+
+#if !defined(BENCHMARK_CALLS)
+#define BENCHMARK_CALLS 10000
+#endif
+
+class BenchmarkCalls : public testing::Test {
+ public:
+  void SetUp() override { sut = std::make_unique<example>(m1, m2, m3); }
+
+  testing::NiceMock<mock_interface1> m1;
+  testing::NiceMock<mock_interface2> m2;
+  testing::NiceMock<mock_interface3> m3;
+  std::unique_ptr<example> sut;
+};
+
+TEST_F(BenchmarkCalls, ShouldMeasureMockedCallsPerSecond) {
+  using namespace testing;
+
+  EXPECT_CALL(m1, f1(42)).WillRepeatedly(Return(true));
+  EXPECT_CALL(m2, f2_1()).Times(BENCHMARK_CALLS);
+  EXPECT_CALL(m3, f3(0, 1, 2)).Times(BENCHMARK_CALLS);
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  for (auto i = 0; i < BENCHMARK_CALLS; ++i) {
+    sut->test();
+  }
+  const auto elapsed = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+  std::cout << "[ gtest    ] " << static_cast<long long>(3 * BENCHMARK_CALLS / elapsed) << " calls/sec" << std::endl;
+}
@@ -0,0 +1,26 @@
+//
+// Copyright (c) 2016-2017 Kris Jusiak (kris at jusiak dot net)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include <string>
+
+struct interface4 {
+  virtual bool is_connection_established() const = 0;
+  virtual bool is_authentication_required() const = 0;
+  virtual bool is_transaction_in_progress() const = 0;
+  virtual int get_number_of_pending_requests() const = 0;
+  virtual int get_number_of_retries_left() const = 0;
+  virtual int get_maximum_payload_size_in_bytes() const = 0;
+  virtual void on_connection_established(int) = 0;
+  virtual void on_connection_lost(int) = 0;
+  virtual void on_request_received(int, const std::string&) = 0;
+  virtual void on_response_received(int, const std::string&) = 0;
+  virtual void on_transaction_committed(int, const std::string&) = 0;
+  virtual void on_transaction_rolled_back(int, const std::string&) = 0;
+  virtual ~interface4() noexcept = default;
+};
@@ -0,0 +1,508 @@
+//
+// Copyright (c) 2016-2017 Kris Jusiak (kris at jusiak dot net)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//
+#pragma once
+
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace testing {
+inline namespace v1 {
+namespace detail {
+
+struct section {
+  const char *data = nullptr;
+  std::size_t size = 0;
+
+  const char *at(std::uint64_t offset) const {
+    return offset < size && std::memchr(data + offset, 0, size - offset) ? data + offset : "";
+  }
+};
+
+class byte_reader {
+ public:
+  byte_reader(const char *data, std::size_t size) : data(data), size(size) {}
+
+  bool ok() const { return pos <= size; }
+  bool eof() const { return pos >= size; }
+  std::size_t tell() const { return pos; }
+  void seek(std::size_t p) { pos = p; }
+  void skip(std::uint64_t n) { pos = ok() && n <= size - pos ? pos + n : size + 1; }
+
+  byte_reader sub(std::uint64_t n) const { return ok() && n <= size - pos ? byte_reader{data + pos, n} : byte_reader{data, 0}; }
+
+  template <class T>
+  T fixed() {
+    T value{};
+    if (ok() && sizeof(T) <= size - pos) {
+      std::memcpy(&value, data + pos, sizeof(T));
+    }
+    skip(sizeof(T));
+    return value;
+  }
+
+  std::uint64_t fixed(std::size_t n) {
+    switch (n) {
+      case 1:
+        return fixed<std::uint8_t>();
+      case 2:
+        return fixed<std::uint16_t>();
+      case 4:
+        return fixed<std::uint32_t>();
+      case 8:
+        return fixed<std::uint64_t>();
+    }
+    skip(n);
+    return {};
+  }
+
+  std::uint64_t uleb() {
+    std::uint64_t value = 0;
+    for (auto shift = 0u; ok() && !eof(); shift += 7) {
+      const auto byte = static_cast<std::uint8_t>(data[pos++]);
+      if (shift < 64) {
+        value |= std::uint64_t(byte & 0x7f) << shift;
+      }
+      if (!(byte & 0x80)) {
+        return value;
+      }
+    }
+    pos = size + 1;
+    return value;
+  }
+
+  std::int64_t sleb() {
+    std::uint64_t value = 0;
+    for (auto shift = 0u; ok() && !eof();) {
+      const auto byte = static_cast<std::uint8_t>(data[pos++]);
+      if (shift < 64) {
+        value |= std::uint64_t(byte & 0x7f) << shift;
+      }
+      shift += 7;
+      if (!(byte & 0x80)) {
+        if (shift < 64 && (byte & 0x40)) {
+          value |= ~std::uint64_t{} << shift;
+        }
+        return static_cast<std::int64_t>(value);
+      }
+    }
+    pos = size + 1;
+    return static_cast<std::int64_t>(value);
+  }
+
+  const char *str() {
+    const auto begin = pos;
+    while (pos < size && data[pos]) ++pos;
+    if (pos >= size) {
+      pos = size + 1;
+      return "";
+    }
+    ++pos;
+    return data + begin;
+  }
+
+ private:
+  const char *data = nullptr;
+  std::size_t size = 0;
+  std::size_t pos = 0;
+};
+
+/**
+ * Address to file:line table built from a DWARF (v2-v5) .debug_line section
+ */
+class line_table {
+  enum { DW_LNS_extended_op, DW_LNS_copy, DW_LNS_advance_pc, DW_LNS_advance_line, DW_LNS_set_file };
+  enum { DW_LNS_const_add_pc = 8, DW_LNS_fixed_advance_pc };
+  enum { DW_LNE_end_sequence = 1, DW_LNE_set_address, DW_LNE_define_file };
+  enum { DW_LNCT_path = 1, DW_LNCT_directory_index };
+  enum {
+    DW_FORM_block2 = 0x03,
+    DW_FORM_block4 = 0x04,
+    DW_FORM_data2 = 0x05,
+    DW_FORM_data4 = 0x06,
+    DW_FORM_data8 = 0x07,
+    DW_FORM_string = 0x08,
+    DW_FORM_block = 0x09,
+    DW_FORM_block1 = 0x0a,
+    DW_FORM_data1 = 0x0b,
+    DW_FORM_sdata = 0x0d,
+    DW_FORM_strp = 0x0e,
+    DW_FORM_udata = 0x0f,
+    DW_FORM_data16 = 0x1e,
+    DW_FORM_line_strp = 0x1f
+  };
+
+  struct row {
+    std::uint64_t addr;
+    std::uint32_t file;
+    std::uint32_t line;  // 0 - end of sequence
+  };
+
+ public:
+  line_table() = default;
+
+  explicit line_table(const section &debug_line, const section &debug_line_str = {}, const section &debug_str = {}) {
+    byte_reader r{debug_line.data, debug_line.size};
+    while (r.ok() && !r.eof()) {
+      std::uint64_t length = r.fixed<std::uint32_t>();
+      std::size_t offset_size = 4;
+      if (length == 0xffffffff) {
+        length = r.fixed<std::uint64_t>();
+        offset_size = 8;
+      }
+      auto unit = r.sub(length);
+      r.skip(length);
+      if (!parse(unit, offset_size, debug_line_str, debug_str)) {
+        break;
+      }
+    }
+
+    std::stable_sort(rows.begin(), rows.end(), [](const row &lhs, const row &rhs) {
+      return lhs.addr < rhs.addr || (lhs.addr == rhs.addr && !lhs.line && rhs.line);
+    });
+  }
+
+  bool empty() const { return rows.empty(); }
+
+  std::pair<std::string, int> operator()(std::uint64_t addr) const {
+    auto it = std::upper_bound(rows.begin(), rows.end(), addr, [](std::uint64_t addr, const row &r) { return addr < r.addr; });
+    if (it == rows.begin() || !(--it)->line) {
+      return {"", 0};
+    }
+    return {files[it->file], static_cast<int>(it->line)};
+  }
+
+ private:
+  bool parse(byte_reader r, std::size_t offset_size, const section &line_str, const section &str) {
+    const auto version = r.fixed<std::uint16_t>();
+    if (version < 2 || version > 5) {
+      return false;
+    }
+    if (version >= 5) {
+      r.fixed<std::uint8_t>();  // address_size
+      r.fixed<std::uint8_t>();  // segment_selector_size
+    }
+    const auto header_length = r.fixed(offset_size);
+    auto program = r;
+    program.skip(header_length);
+
+    const auto min_inst_length = r.fixed<std::uint8_t>();
+    if (version >= 4) {
+      r.fixed<std::uint8_t>();  // maximum_operations_per_instruction
+    }
+    r.fixed<std::uint8_t>();  // default_is_stmt
+    const auto line_base = r.fixed<std::int8_t>();
+    const auto line_range = r.fixed<std::uint8_t>();
+    const auto opcode_base = r.fixed<std::uint8_t>();
+    std::vector<std::uint8_t> opcode_lengths;
+    for (auto i = 1; i < opcode_base; ++i) {
+      opcode_lengths.push_back(r.fixed<std::uint8_t>());
+    }
+    if (!r.ok() || !line_range) {
+      return false;
+    }
+
+    std::vector<std::string> dirs;
+    std::vector<std::uint32_t> unit_files;
+    const auto add_file = [&](const char *name, std::uint64_t dir) {
+      files.push_back(*name != '/' && dir < dirs.size() && !dirs[dir].empty() ? dirs[dir] + "/" + name : name);
+      unit_files.push_back(files.size() - 1);
+    };
+
+    if (version >= 5) {
+      if (!entries(r, offset_size, line_str, str, [&](const char *path, std::uint64_t) { dirs.push_back(path); }) ||
+          !entries(r, offset_size, line_str, str, add_file)) {
+        return false;
+      }
+    } else {
+      dirs.emplace_back();  // compilation directory
+      for (auto dir = r.str(); *dir; dir = r.str()) {
+        dirs.push_back(dir);
+      }
+      unit_files.push_back(0);  // file indices start at 1
+      for (auto name = r.str(); *name; name = r.str()) {
+        const auto dir = r.uleb();
+        r.uleb();  // modification time
+        r.uleb();  // length
+        add_file(name, dir);
+      }
+    }
+
+    std::uint64_t addr = 0, file = 1;
+    std::int64_t line = 1;
+    const auto emit = [&](bool end_sequence) {
+      rows.push_back(row{addr, end_sequence || file >= unit_files.size() ? 0 : unit_files[file],
+                         end_sequence ? 0 : static_cast<std::uint32_t>(line)});
+    };
+
+    while (program.ok() && !program.eof()) {
+      const auto opcode = program.fixed<std::uint8_t>();
+      if (opcode >= opcode_base) {
+        const auto adjusted = opcode - opcode_base;
+        addr += (adjusted / line_range) * min_inst_length;
+        line += line_base + adjusted % line_range;
+        emit(false);
+        continue;
+      }
+
+      switch (opcode) {
+        case DW_LNS_extended_op: {
+          const auto length = program.uleb();
+          const auto next = program.tell() + length;
+          if (!length) {
+            break;
+          }
+          switch (program.fixed<std::uint8_t>()) {
+            case DW_LNE_end_sequence:
+              emit(true);
+              addr = 0, file = 1, line = 1;
+              break;
+            case DW_LNE_set_address:
+              addr = program.fixed(length - 1);
+              break;
+            case DW_LNE_define_file: {
+              const auto name = program.str();
+              add_file(name, program.uleb());
+            } break;
+          }
+          program.seek(next);
+        } break;
+        case DW_LNS_copy:
+          emit(false);
+          break;
+        case DW_LNS_advance_pc:
+          addr += program.uleb() * min_inst_length;
+          break;
+        case DW_LNS_advance_line:
+          line += program.sleb();
+          break;
+        case DW_LNS_set_file:
+          file = program.uleb();
+          break;
+        case DW_LNS_const_add_pc:
+          addr += ((255 - opcode_base) / line_range) * min_inst_length;
+          break;
+        case DW_LNS_fixed_advance_pc:
+          addr += program.fixed<std::uint16_t>();
+          break;
+        default:
+          for (auto i = 0; i < opcode_lengths[opcode - 1]; ++i) {
+            program.uleb();
+          }
+      }
+    }
+    return true;
+  }
+
+  template <class F>
+  bool entries(byte_reader &r, std::size_t offset_size, const section &line_str, const section &str, F f) {
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> formats(r.fixed<std::uint8_t>());
+    for (auto &format : formats) {
+      format.first = r.uleb();
+      format.second = r.uleb();
+    }
+
+    const auto count = r.uleb();
+    if (formats.empty()) {
+      return r.ok() && !count;
+    }
+
+    for (auto i = 0u; i < count && r.ok(); ++i) {
+      const char *path = "";
+      std::uint64_t dir = 0;
+      for (const auto &format : formats) {
+        const char *s = nullptr;
+        std::uint64_t value = 0;
+        switch (format.second) {
+          case DW_FORM_string:
+            s = r.str();
+            break;
+          case DW_FORM_line_strp:
+            s = line_str.at(r.fixed(offset_size));
+            break;
+          case DW_FORM_strp:
+            s = str.at(r.fixed(offset_size));
+            break;
+          case DW_FORM_udata:
+            value = r.uleb();
+            break;
+          case DW_FORM_sdata:
+            r.sleb();
+            break;
+          case DW_FORM_data1:
+            value = r.fixed(1);
+            break;
+          case DW_FORM_data2:
+            value = r.fixed(2);
+            break;
+          case DW_FORM_data4:
+            value = r.fixed(4);
+            break;
+          case DW_FORM_data8:
+            value = r.fixed(8);
+            break;
+          case DW_FORM_data16:
+            r.skip(16);
+            break;
+          case DW_FORM_block:
+            r.skip(r.uleb());
+            break;
+          case DW_FORM_block1:
+            r.skip(r.fixed(1));
+            break;
+          case DW_FORM_block2:
+            r.skip(r.fixed(2));
+            break;
+          case DW_FORM_block4:
+            r.skip(r.fixed(4));
+            break;
+          default:
+            return false;  // DW_FORM_strx* requires .debug_str_offsets
+        }
+        if (format.first == DW_LNCT_path && s) {
+          path = s;
+        } else if (format.first == DW_LNCT_directory_index) {
+          dir = value;
+        }
+      }
+      f(path, dir);
+    }
+    return r.ok();
+  }
+
+  std::vector<std::string> files{std::string{}};
+  std::vector<row> rows;
+};
+
+/**
+ * Maps an ELF file and reads its uncompressed .debug_line section
+ * @return empty table when the file or its debug information is not available
+ */
+inline line_table load_line_table(const std::string &path) {
+  const auto fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return {};
+  }
+  struct stat st {};
+  const auto size = fstat(fd, &st) ? 0 : static_cast<std::size_t>(st.st_size);
+  const auto addr = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return {};
+  }
+  std::shared_ptr<void> unmap{addr, [size](void *ptr) { munmap(ptr, size); }};
+
+  const auto data = static_cast<const char *>(addr);
+  const auto ehdr = static_cast<const ElfW(Ehdr) *>(addr);
+  if (size < sizeof(ElfW(Ehdr)) || std::memcmp(ehdr->e_ident, ELFMAG, SELFMAG) ||
+      ehdr->e_ident[EI_CLASS] != (sizeof(void *) == 8 ? ELFCLASS64 : ELFCLASS32) || ehdr->e_shoff > size ||
+      ehdr->e_shentsize != sizeof(ElfW(Shdr)) || ehdr->e_shnum > (size - ehdr->e_shoff) / sizeof(ElfW(Shdr)) ||
+      ehdr->e_shstrndx >= ehdr->e_shnum) {
+    return {};
+  }
+
+  const auto shdrs = reinterpret_cast<const ElfW(Shdr) *>(data + ehdr->e_shoff);
+  const auto to_section = [&](const ElfW(Shdr) & shdr) {
+    section s;
+    if (shdr.sh_type != SHT_NOBITS && !(shdr.sh_flags & SHF_COMPRESSED) && shdr.sh_offset <= size &&
+        shdr.sh_size <= size - shdr.sh_offset) {
+      s.data = data + shdr.sh_offset;
+      s.size = shdr.sh_size;
+    }
+    return s;
+  };
+
+  const auto names = to_section(shdrs[ehdr->e_shstrndx]);
+  section debug_line, debug_line_str, debug_str;
+  for (auto i = 0; i < ehdr->e_shnum; ++i) {
+    const auto name = names.at(shdrs[i].sh_name);
+    if (!std::strcmp(name, ".debug_line")) {
+      debug_line = to_section(shdrs[i]);
+    } else if (!std::strcmp(name, ".debug_line_str")) {
+      debug_line_str = to_section(shdrs[i]);
+    } else if (!std::strcmp(name, ".debug_str")) {
+      debug_str = to_section(shdrs[i]);
+    }
+  }
+  return line_table{debug_line, debug_line_str, debug_str};
+}
+
+struct loaded_module {
+  std::string path;
+  std::uintptr_t bias = 0;
+  std::vector<std::pair<std::uintptr_t, std::uintptr_t>> segments;
+  std::unique_ptr<line_table> table;
+
+  bool contains(std::uintptr_t addr) const {
+    return std::any_of(segments.begin(), segments.end(),
+                       [addr](const auto &segment) { return addr >= segment.first && addr < segment.second; });
+  }
+};
+
+/**
+ * Resolves an address of the running process using .debug_line of the executable or the shared object it belongs to
+ * Line tables are parsed once, on the first lookup within a module, and cached for the rest of the run
+ * @return file and line ({"", 0} when unknown)
+ */
+inline std::pair<std::string, int> debug_line(void *addr) {
+  static std::mutex mutex;
+  static std::vector<loaded_module> modules;
+  std::lock_guard<std::mutex> lock{mutex};
+
+  const auto pc = reinterpret_cast<std::uintptr_t>(addr);
+  const auto find = [pc] {
+    return std::find_if(modules.begin(), modules.end(), [pc](const auto &module) { return module.contains(pc); });
+  };
+
+  auto it = find();
+  if (it == modules.end()) {
+    dl_iterate_phdr(
+        [](dl_phdr_info *info, std::size_t, void *) {
+          loaded_module module;
+          module.path = info->dlpi_name && *info->dlpi_name ? info->dlpi_name : "/proc/self/exe";
+          module.bias = info->dlpi_addr;
+          for (auto i = 0; i < info->dlpi_phnum; ++i) {
+            const auto &phdr = info->dlpi_phdr[i];
+            if (phdr.p_type == PT_LOAD) {
+              module.segments.emplace_back(module.bias + phdr.p_vaddr, module.bias + phdr.p_vaddr + phdr.p_memsz);
+            }
+          }
+          if (std::none_of(modules.begin(), modules.end(), [&module](const auto &m) {
+                return m.bias == module.bias && m.path == module.path;
+              })) {
+            modules.push_back(std::move(module));
+          }
+          return 0;
+        },
+        nullptr);
+    it = find();
+  }
+
+  if (it == modules.end()) {
+    return {"", 0};
+  }
+  if (!it->table) {
+    it->table = std::make_unique<line_table>(load_line_table(it->path));
+  }
+  return (*it->table)(pc - it->bias);
+}
+
+}  // detail
+}  // v1
+}  // testing
@@ -9,18 +9,30 @@
 
 #include <cxxabi.h>
 #include <execinfo.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <algorithm>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <memory>
+#include <mutex>
+#include <new>
+#include <ostream>
 #include <set>
 #include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "GUnit/Detail/TypeTraits.h"
 
 #if defined(__APPLE__)
 #include <libproc.h>
 #elif defined(__linux__)
+#include "GUnit/Detail/DebugLine.h"
 extern const char *__progname_full;
 #endif
 
@@ -28,6 +40,10 @@ extern const char *__progname_full;
 #define GUNIT_SHOW_STACK_SIZE 1
 #endif
 
+#if !defined(GUNIT_ARENA_BLOCK_SIZE)
+#define GUNIT_ARENA_BLOCK_SIZE 4096
+#endif
+
 namespace testing {
 inline namespace v1 {
 namespace detail {
@@ -91,6 +107,77 @@ inline TDst union_cast(TSrc src) {
   return u.dst;
 }
 
+/**
+ * Monotonic allocator
+ * Objects are destroyed (in reverse order of creation) and memory is released at once by `reset`
+ */
+class arena {
+  struct block {
+    std::unique_ptr<byte[]> data;
+    std::size_t size;
+  };
+
+  struct cleanup {
+    void (*destroy)(void *);
+    void *object;
+  };
+
+ public:
+  explicit arena(std::size_t block_size = GUNIT_ARENA_BLOCK_SIZE) : block_size(block_size) {}
+  arena(arena &&other) noexcept
+      : block_size(other.block_size),
+        blocks(std::move(other.blocks)),
+        cleanups(std::move(other.cleanups)),
+        used(other.used) {
+    other.blocks.clear();
+    other.cleanups.clear();
+    other.used = 0;
+  }
+  arena(const arena &) = delete;
+  arena &operator=(const arena &) = delete;
+  ~arena() { reset(); }
+
+  void *allocate(std::size_t size, std::size_t alignment) {
+    auto offset = blocks.empty() ? 0 : (used + alignment - 1) & ~(alignment - 1);
+    if (blocks.empty() || offset + size > blocks.back().size) {
+      const auto block_size = std::max(this->block_size, size + alignment);
+      blocks.push_back(block{std::unique_ptr<byte[]>{new byte[block_size]}, block_size});
+      offset = (alignment - reinterpret_cast<std::uintptr_t>(blocks.back().data.get()) % alignment) % alignment;
+    }
+    used = offset + size;
+    return blocks.back().data.get() + offset;
+  }
+
+  template <class T, class... TArgs>
+  T *make(TArgs &&... args) {
+    auto *object = new (allocate(sizeof(T), alignof(T))) T(std::forward<TArgs>(args)...);
+    if (!std::is_trivially_destructible<T>::value) {
+      cleanups.push_back(cleanup{[](void *object) { static_cast<T *>(object)->~T(); }, object});
+    }
+    return object;
+  }
+
+  /**
+   * Destroys all objects, the first block is kept for reuse
+   */
+  void reset() {
+    for (auto it = cleanups.rbegin(); it != cleanups.rend(); ++it) {
+      it->destroy(it->object);
+    }
+    cleanups.clear();
+    if (blocks.size() > 1) {
+      blocks.erase(blocks.begin() + 1, blocks.end());
+    }
+    used = 0;
+  }
+
+ private:
+  std::size_t block_size = GUNIT_ARENA_BLOCK_SIZE;
+  std::vector<block> blocks;
+  std::vector<cleanup> cleanups;
+  std::size_t used = 0;
+};
+
 template <char... Chrs>
 struct string {
   static auto c_str() {
@@ -104,14 +191,31 @@ struct string {
   }
 };
 
-template <class TStr, std::size_t N, char... Chrs>
-struct make_string : make_string<TStr, N - 1, TStr().chrs[N - 1], Chrs...> {};
+template <class TStr, class>
+struct make_string_impl;
 
-template <class TStr, char... Chrs>
-struct make_string<TStr, 0, Chrs...> {
-  using type = string<Chrs...>;
+template <class TStr, std::size_t... Ns>
+struct make_string_impl<TStr, std::index_sequence<Ns...>> {
+  using type = string<TStr().chrs[Ns]...>;
 };
 
+/**
+ * First `N` characters of `TStr().chrs` as `string<...>` (template depth doesn't depend on `N`)
+ */
+template <class TStr, std::size_t N>
+struct make_string : make_string_impl<TStr, std::make_index_sequence<N>> {};
+
+/**
+ * FNV-1a hash, used as a compile time identity of names
+ */
+constexpr std::uint64_t fnv1a(const char *str) {
+  std::uint64_t hash = 14695981039346656037ull;
+  while (*str) {
+    hash = (hash ^ static_cast<unsigned char>(*str++)) * 1099511628211ull;
+  }
+  return hash;
+}
+
 namespace operators {
 
 #if defined(__clang__)
@@ -147,6 +251,103 @@ inline void trim(std::string &txt) {
   txt.erase(txt.find_last_not_of(" \n\r\t") + 1);
 }
 
+class string_view {
+ public:
+  string_view() = default;
+  string_view(const char *data, std::size_t size) : data_(data), size_(size) {}
+
+  const char *data() const { return data_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return !size_; }
+  std::string str() const { return {data_, size_}; }
+
+  friend std::ostream &operator<<(std::ostream &os, const string_view &sv) { return os.write(sv.data_, sv.size_); }
+
+ private:
+  const char *data_ = "";
+  std::size_t size_ = 0;
+};
+
+/**
+ * Process-wide cache of source files
+ * Each file is mapped into memory and indexed by line once, snippets stay valid until the end of the run
+ */
+class source_cache {
+  class source {
+   public:
+    explicit source(const std::string &file) {
+      const auto fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+        return;
+      }
+      struct stat st {};
+      const auto size = fstat(fd, &st) ? 0 : static_cast<std::size_t>(st.st_size);
+      const auto addr = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+      close(fd);
+      if (addr == MAP_FAILED) {
+        return;
+      }
+
+      data = static_cast<const char *>(addr);
+      size_ = size;
+      lines.push_back(0);
+      for (auto ptr = data; (ptr = static_cast<const char *>(std::memchr(ptr, '\n', data + size_ - ptr)));) {
+        lines.push_back(++ptr - data);
+      }
+    }
+
+    source(const source &) = delete;
+    source &operator=(const source &) = delete;
+
+    ~source() {
+      if (data) {
+        munmap(const_cast<char *>(data), size_);
+      }
+    }
+
+    string_view line(int n) const {
+      if (n < 1 || std::size_t(n) > lines.size()) {
+        return {};
+      }
+      auto begin = data + lines[n - 1];
+      auto end = std::size_t(n) < lines.size() ? data + lines[n] : data + size_;
+      const auto is_space = [](char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; };
+      while (begin < end && is_space(*begin)) ++begin;
+      while (end > begin && is_space(end[-1])) --end;
+      return {begin, std::size_t(end - begin)};
+    }
+
+   private:
+    const char *data = nullptr;
+    std::size_t size_ = 0;
+    std::vector<std::size_t> lines;
+  };
+
+ public:
+  static source_cache &instance() {
+    static source_cache cache;
+    return cache;
+  }
+
+  /**
+   * @return trimmed line (1-based) of the file, empty when not available
+   */
+  string_view line(const std::string &file, int n) {
+    std::lock_guard<std::mutex> lock{mutex};
+    auto &src = sources[file];
+    if (!src) {
+      src = std::make_unique<source>(file);
+    }
+    return src->line(n);
+  }
+
+ private:
+  std::mutex mutex;
+  std::unordered_map<std::string, std::unique_ptr<source>> sources;
+};
+
+inline string_view source_line(const std::string &file, int line) { return source_cache::instance().line(file, line); }
+
 inline std::string demangle(const std::string &mangled) {
   const auto demangled = abi::__cxa_demangle(mangled.c_str(), 0, 0, 0);
   if (demangled) {
@@ -156,10 +357,8 @@ inline std::string demangle(const std::string &mangled) {
   return {};
 }
 
-inline std::string call_stack(const std::string &newline, int stack_begin = 1, int stack_size = GUNIT_SHOW_STACK_SIZE) {
-  static constexpr auto MAX_CALL_STACK_SIZE = 64;
-  void *bt[MAX_CALL_STACK_SIZE];
-  const auto frames = backtrace(bt, sizeof(bt) / sizeof(bt[0]));
+inline std::string call_stack(void *const *bt, int frames, const std::string &newline, int stack_begin = 0,
+                              int stack_size = GUNIT_SHOW_STACK_SIZE) {
   const auto symbols = backtrace_symbols(bt, frames);
   std::shared_ptr<char *> free{symbols, std::free};
   std::stringstream result;
@@ -186,6 +385,27 @@ inline std::string call_stack(const std::string &newline, int stack_begin = 1, i
   return result.str();
 }
 
+inline std::string call_stack(const std::string &newline, int stack_begin = 1, int stack_size = GUNIT_SHOW_STACK_SIZE) {
+  static constexpr auto MAX_CALL_STACK_SIZE = 64;
+  void *bt[MAX_CALL_STACK_SIZE];
+  const auto frames = backtrace(bt, sizeof(bt) / sizeof(bt[0]));
+  return call_stack(bt, frames, newline, stack_begin, stack_size);
+}
+
+/**
+ * Captures the call stack starting from the frame which `ret` returns to (regardless of inlined frames above it)
+ * @return number of captured frames (0 when `ret` is not on the current call stack)
+ */
+inline int backtrace_from(const void *ret, void **bt, int size) {
+  static constexpr auto MAX_CALL_STACK_SIZE = 64;
+  void *frames[MAX_CALL_STACK_SIZE];
+  const auto end = frames + backtrace(frames, sizeof(frames) / sizeof(frames[0]));
+  const auto begin = std::find(frames, end, ret);
+  const auto count = std::min<int>(size, end - begin);
+  std::copy(begin, begin + count, bt);
+  return count;
+}
+
 inline auto &progname() {
 #if defined(__linux__)
   static auto self = __progname_full;
@@ -196,29 +416,57 @@ inline auto &progname() {
   return self;
 }
 
-inline std::pair<std::string, int> addr2line(void *addr) {
+/**
+ * Resolves all given addresses in-process (Linux) and the remaining ones with a single addr2line process
+ * @return file and line for each address, in the same order ({"", 0} when unknown)
+ */
+inline std::vector<std::pair<std::string, int>> addr2line(const std::vector<void *> &addrs) {
+  std::vector<std::pair<std::string, int>> result(addrs.size(), std::make_pair(std::string{}, 0));
+  std::vector<std::size_t> unresolved;
+  for (auto i = 0u; i < addrs.size(); ++i) {
+#if defined(__linux__)
+    result[i] = debug_line(addrs[i]);
+    if (!result[i].first.empty()) {
+      continue;
+    }
+#endif
+    unresolved.push_back(i);
+  }
+  if (unresolved.empty()) {
+    return result;
+  }
+
   std::stringstream cmd;
-  cmd << "addr2line -Cpe " << progname() << " " << addr;
+  cmd << "addr2line -Cpe " << progname();
+  for (const auto i : unresolved) {
+    cmd << " " << addrs[i];
+  }
 
-  std::string data;
   auto fp = popen(cmd.str().c_str(), "r");
-  if (fp) {
-    char buf[64] = {};
-    while (fgets(buf, sizeof(buf), fp)) {
-      data += buf;
-    }
-  } else {
-    return {"", 0};
+  if (!fp) {
+    return result;
+  }
+
+  std::string data;
+  char buf[64] = {};
+  while (fgets(buf, sizeof(buf), fp)) {
+    data += buf;
   }
   pclose(fp);
 
-  data.erase(std::remove(data.begin(), data.end(), '\n'), data.end());
-  const auto space = data.find(" ");
-  std::string res2 = data.substr(0, space);
-  const auto colon = res2.find(":");
-  return {res2.substr(0, colon), std::atoi(res2.substr(colon + 1).c_str())};
+  std::stringstream lines{data};
+  std::string line;
+  for (auto i = 0u; i < unresolved.size() && std::getline(lines, line); ++i) {
+    const auto space = line.find(" ");
+    const auto res2 = line.substr(0, space);
+    const auto colon = res2.find(":");
+    result[unresolved[i]] = {res2.substr(0, colon), std::atoi(res2.substr(colon + 1).c_str())};
+  }
+  return result;
 }
 
+inline std::pair<std::string, int> addr2line(void *addr) { return addr2line(std::vector<void *>{addr}).front(); }
+
 }  // detail
 }  // v1
 }  // testing
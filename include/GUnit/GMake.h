@@ -7,11 +7,15 @@
 //
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <new>
 #include <stdexcept>
 #include <typeinfo>
-#include <unordered_map>
 #include <utility>
+#include <vector>
 #include "GUnit/Detail/TypeTraits.h"
 #include "GUnit/Detail/Utility.h"
 #include "GUnit/GMock.h"
@@ -20,6 +24,10 @@
 #define GUNIT_MAX_CTOR_SIZE 10
 #endif
 
+#if !defined(GUNIT_MAKE_SINGLE_ALLOCATION)
+#define GUNIT_MAKE_SINGLE_ALLOCATION 0
+#endif
+
 namespace testing {
 inline namespace v1 {
 namespace detail {
@@ -59,6 +67,11 @@ struct deref<NiceGMock<T>> {
   using type = typename deref<T>::type;
 };
 
+template <class T>
+struct deref<StubGMock<T>> {
+  using type = typename deref<T>::type;
+};
+
 template <class T>
 using deref_t = typename deref<std::remove_cv_t<T>>::type;
 
@@ -74,6 +87,9 @@ struct is_gmock<StrictGMock> : std::true_type {};
 template <>
 struct is_gmock<NiceGMock> : std::true_type {};
 
+template <>
+struct is_gmock<StubGMock> : std::true_type {};
+
 template <class>
 struct is_gmock_type : std::false_type {};
 
@@ -86,6 +102,9 @@ struct is_gmock_type<StrictGMock<T>> : std::true_type {};
 template <class T>
 struct is_gmock_type<NiceGMock<T>> : std::true_type {};
 
+template <class T>
+struct is_gmock_type<StubGMock<T>> : std::true_type {};
+
 template <class T, class U>
 using is_copy_ctor = std::is_same<deref_t<T>, deref_t<U>>;
 
@@ -113,6 +132,11 @@ decltype(auto) convert(NiceGMock<T> *mock) {
   return &static_cast<T &>(*mock);
 }
 
+template <class T>
+decltype(auto) convert(StubGMock<T> *mock) {
+  return &static_cast<T &>(*mock);
+}
+
 template <class T>
 decltype(auto) convert(GMock<T> &mock) {
   return static_cast<T &>(mock);
@@ -128,6 +152,11 @@ decltype(auto) convert(NiceGMock<T> &mock) {
   return static_cast<T &>(mock);
 }
 
+template <class T>
+decltype(auto) convert(StubGMock<T> &mock) {
+  return static_cast<T &>(mock);
+}
+
 template <class T>
 decltype(auto) convert(T &&arg) {
   return std::forward<T>(arg);
@@ -148,6 +177,11 @@ decltype(auto) convert(std::unique_ptr<NiceGMock<T>> &&mock) {
   return std::move(mock);
 }
 
+template <class T>
+decltype(auto) convert(std::unique_ptr<StubGMock<T>> &&mock) {
+  return std::move(mock);
+}
+
 template <class T>
 decltype(auto) convert(std::shared_ptr<GMock<T>> &mock) {
   return std::static_pointer_cast<T>(mock);
@@ -163,6 +197,11 @@ decltype(auto) convert(std::shared_ptr<NiceGMock<T>> &mock) {
   return std::static_pointer_cast<T>(mock);
 }
 
+template <class T>
+decltype(auto) convert(std::shared_ptr<StubGMock<T>> &mock) {
+  return std::shared_ptr<T>{mock, reinterpret_cast<T *>(mock.get())};
+}
+
 template <class T, class... TArgs>
 auto make_impl(detail::identity<std::unique_ptr<T>>, TArgs &&... args) {
   return std::make_unique<T>(detail::convert(std::forward<TArgs>(args))...);
@@ -177,6 +216,135 @@ template <class T, class... TArgs>
 auto make_impl(detail::identity<T>, TArgs &&... args) {
   return T(detail::convert(std::forward<TArgs>(args))...);
 }
+
+/**
+ * Mocks of a single `make` placed one after another in memory allocated together with the shared_ptr control block
+ * Mocks are destroyed in reverse order of construction when the last of them is released
+ */
+class make_block {
+  struct header {
+    void (*destroy)(void *);
+    header *prev;
+  };
+
+ public:
+  static constexpr std::size_t align(std::size_t size) {
+    return (size + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+  }
+
+  template <class T>
+  static constexpr std::size_t footprint() {
+    return alignof(T) > alignof(std::max_align_t) ? 0 : align(sizeof(header)) + align(sizeof(T));
+  }
+
+  make_block(byte *const &data, std::size_t size) : data(data), size(size) {}
+  make_block(const make_block &) = delete;
+  make_block &operator=(const make_block &) = delete;
+
+  ~make_block() {
+    for (auto *it = last; it; it = it->prev) {
+      it->destroy(reinterpret_cast<byte *>(it) + align(sizeof(header)));
+    }
+  }
+
+  /**
+   * @return nullptr when T doesn't fit
+   */
+  template <class T>
+  T *make() {
+    if (!footprint<T>() || used + footprint<T>() > size) {
+      return nullptr;
+    }
+    auto *object = new (data + used + align(sizeof(header))) T();
+    last = new (data + used) header{[](void *object) { static_cast<T *>(object)->~T(); }, last};
+    used += footprint<T>();
+    return object;
+  }
+
+  bool contains(const void *ptr) const { return ptr >= data && ptr < data + size; }
+
+ private:
+  byte *data = nullptr;
+  std::size_t size = 0;
+  std::size_t used = 0;
+  header *last = nullptr;
+};
+
+/**
+ * Allocates the shared_ptr control block (make_block included) followed by `size` bytes for mocks
+ */
+template <class T>
+class make_block_allocator {
+  template <class>
+  friend class make_block_allocator;
+
+ public:
+  using value_type = T;
+
+  make_block_allocator(std::size_t size, byte *&data) : size(size), data(&data) {}
+  template <class U>
+  make_block_allocator(const make_block_allocator<U> &other) : size(other.size), data(other.data) {}
+
+  T *allocate(std::size_t n) {
+    auto *ptr = static_cast<byte *>(::operator new(make_block::align(n * sizeof(T)) + size));
+    *data = ptr + make_block::align(n * sizeof(T));
+    return reinterpret_cast<T *>(ptr);
+  }
+
+  void deallocate(T *ptr, std::size_t) { ::operator delete(ptr); }
+
+  template <class U>
+  bool operator==(const make_block_allocator<U> &) const {
+    return true;
+  }
+
+  template <class U>
+  bool operator!=(const make_block_allocator<U> &) const {
+    return false;
+  }
+
+ private:
+  std::size_t size = 0;
+  byte **data = nullptr;  // where the mocks memory goes, read by make_block on construction
+};
+
+inline std::shared_ptr<make_block> make_shared_block(std::size_t size) {
+  byte *data = nullptr;
+  return std::allocate_shared<make_block>(make_block_allocator<make_block>{size, data}, data, size);
+}
+
+/**
+ * Mocks made while a scope is active (on this thread) go into its block, their footprint is summed up
+ */
+class make_scope {
+ public:
+  explicit make_scope(std::shared_ptr<make_block> block = nullptr) : block(std::move(block)), prev(current()) { current() = this; }
+  make_scope(const make_scope &) = delete;
+  make_scope &operator=(const make_scope &) = delete;
+  ~make_scope() { current() = prev; }
+
+  template <class TMock>
+  static std::shared_ptr<TMock> make() {
+    if (auto *scope = current()) {
+      scope->footprint += make_block::footprint<TMock>();
+      if (auto *mock = scope->block ? scope->block->template make<TMock>() : nullptr) {
+        return std::shared_ptr<TMock>{scope->block, mock};
+      }
+    }
+    return std::make_shared<TMock>();
+  }
+
+  std::size_t footprint = 0;
+
+ private:
+  static make_scope *&current() {
+    static thread_local make_scope *scope = nullptr;
+    return scope;
+  }
+
+  std::shared_ptr<make_block> block;
+  make_scope *prev = nullptr;
+};
 }  // detail
 
 template <class>
@@ -189,8 +357,49 @@ class mock_exception final : public std::exception {
   std::string msg;
 };
 
-class mocks_t : public std::unordered_map<std::size_t, std::shared_ptr<void>> {
+/**
+ * Mocks indexed by type id, SUTs have just a few dependencies hence it's a sorted flat vector
+ */
+class mocks_t {
+  using container_t = std::vector<std::pair<std::size_t, std::shared_ptr<void>>>;
+
  public:
+  using value_type = container_t::value_type;
+  using iterator = container_t::iterator;
+  using const_iterator = container_t::const_iterator;
+
+  mocks_t() = default;
+  mocks_t(const mocks_t &other) : mocks((other.make_deferred(), other.mocks)) {}
+  mocks_t(mocks_t &&other) : mocks((other.make_deferred(), std::move(other.mocks))) {}
+
+  mocks_t &operator=(const mocks_t &other) {
+    other.make_deferred();
+    cancel_deferred();
+    mocks = other.mocks;
+    return *this;
+  }
+
+  mocks_t &operator=(mocks_t &&other) {
+    other.make_deferred();
+    cancel_deferred();
+    mocks = std::move(other.mocks);
+    return *this;
+  }
+
+  /**
+   * Mocks are made by `make(self)` on first access, unless they are assigned before (default mocks of GTest)
+   */
+  void defer(void (*make)(void *), void *self) { deferred = {make, self}; }
+  void cancel_deferred() { deferred = {}; }
+
+  void make_deferred() const {
+    if (deferred.make) {
+      const auto make = deferred;
+      deferred = {};
+      make.make(make.self);
+    }
+  }
+
   template <class TMock>
   decltype(auto) mock() const {
     const auto it = find(detail::type_id<TMock>());
@@ -216,6 +425,78 @@ class mocks_t : public std::unordered_map<std::size_t, std::shared_ptr<void>> {
     }
     return std::static_pointer_cast<TMock>(it->second);
   }
+
+  iterator find(std::size_t id) {
+    make_deferred();
+    const auto it = lower_bound(id);
+    return it != mocks.end() && it->first == id ? it : mocks.end();
+  }
+
+  const_iterator find(std::size_t id) const { return const_cast<mocks_t *>(this)->find(id); }
+
+  std::pair<iterator, bool> emplace(std::size_t id, std::shared_ptr<void> mock) {
+    make_deferred();
+    const auto it = lower_bound(id);
+    if (it != mocks.end() && it->first == id) {
+      return {it, false};
+    }
+    return {mocks.emplace(it, id, std::move(mock)), true};
+  }
+
+  std::shared_ptr<void> &operator[](std::size_t id) { return emplace(id, nullptr).first->second; }
+
+  void reserve(std::size_t size) {
+    make_deferred();
+    mocks.reserve(size);
+  }
+
+  void clear() {
+    make_deferred();
+    mocks.clear();
+  }
+
+  std::size_t size() const {
+    make_deferred();
+    return mocks.size();
+  }
+
+  bool empty() const {
+    make_deferred();
+    return mocks.empty();
+  }
+
+  iterator begin() {
+    make_deferred();
+    return mocks.begin();
+  }
+
+  iterator end() {
+    make_deferred();
+    return mocks.end();
+  }
+
+  const_iterator begin() const {
+    make_deferred();
+    return mocks.begin();
+  }
+
+  const_iterator end() const {
+    make_deferred();
+    return mocks.end();
+  }
+
+ private:
+  struct deferred_t {
+    void (*make)(void *) = nullptr;
+    void *self = nullptr;
+  };
+
+  iterator lower_bound(std::size_t id) {
+    return std::lower_bound(mocks.begin(), mocks.end(), id, [](const value_type &mock, std::size_t id) { return mock.first < id; });
+  }
+
+  container_t mocks;
+  mutable deferred_t deferred;
 };
 
 namespace detail {
@@ -338,8 +619,7 @@ class resolve {
     if (it != mocks.end()) {
       return wrapper<deref_t<T>>{it->second};
     }
-    mocks.emplace(id, std::make_shared<TMock<deref_t<T>>>());
-    return wrapper<deref_t<T>>{mocks[id]};
+    return wrapper<deref_t<T>>{mocks.emplace(id, make_scope::make<TMock<deref_t<T>>>()).first->second};
   }
 
   mocks_t &mocks;
@@ -385,6 +665,32 @@ struct is_creatable_impl<T, std::index_sequence<Ns...>> : std::is_constructible<
 template <class T>
 using is_creatable = is_creatable_impl<T, std::make_index_sequence<ctor_size<T>::value>>;
 
+template <class T, template <class> class TMock, class... TMocks, class... TArgs>
+auto make(std::false_type, TArgs &&... args) {
+  std::tuple<TArgs...> tuple{std::forward<TArgs>(args)...};
+  mocks_t mocks;
+  mocks.reserve(ctor_size<deref_t<T>>::value + sizeof...(TMocks));
+  using swallow = int[];
+  (void)swallow{0, (mocks.emplace(type_id<deref_t<TMocks>>(), make_scope::make<TMocks>()), 0)...};
+  return std::make_pair(make_impl<TMock>(identity<T>{}, mocks, tuple, std::make_index_sequence<ctor_size<deref_t<T>>::value>{}),
+                        std::move(mocks));
+}
+
+/**
+ * Mocks are made in a single block (GUNIT_MAKE_SINGLE_ALLOCATION), sized by the mocks made by the first call
+ * (they are known only while the constructor is being resolved), the SUT is allocated on its own
+ */
+template <class T, template <class> class TMock, class... TMocks, class... TArgs>
+auto make(std::true_type, TArgs &&... args) {
+  static std::atomic<std::size_t> footprint{0};
+  const auto size = footprint.load(std::memory_order_relaxed);
+  make_scope scope{size ? make_shared_block(size) : nullptr};
+  auto result = make<T, TMock, TMocks...>(std::false_type{}, std::forward<TArgs>(args)...);
+  if (!size) {
+    footprint.store(scope.footprint, std::memory_order_relaxed);
+  }
+  return result;
+}
 }  // detail
 
 template <class T, class... TArgs>
@@ -398,13 +704,8 @@ template <class T, template <class> class TMock, class... TMocks,
                                                             detail::bool_list<detail::is_gmock_type<TMocks>::value...>>::value),
           class... TArgs>
 auto make(TArgs &&... args) {
-  std::tuple<TArgs...> tuple{std::forward<TArgs>(args)...};
-  mocks_t mocks;
-  using swallow = int[];
-  (void)swallow{0, (mocks.emplace(detail::type_id<detail::deref_t<TMocks>>(), std::make_shared<TMocks>()), 0)...};
-  return std::make_pair(detail::make_impl<TMock>(detail::identity<T>{}, mocks, tuple,
-                                                 std::make_index_sequence<detail::ctor_size<detail::deref_t<T>>::value>{}),
-                        mocks);
+  return detail::make<T, TMock, TMocks...>(std::integral_constant<bool, GUNIT_MAKE_SINGLE_ALLOCATION>{},
+                                           std::forward<TArgs>(args)...);
 }
 }  // v1
 }  // testing
@@ -437,6 +738,7 @@ using GMock = detail::Mock<testing::GMock>;
 using NaggyGMock = detail::Mock<testing::NaggyGMock>;
 using StrictGMock = detail::Mock<testing::StrictGMock>;
 using NiceGMock = detail::Mock<testing::NiceGMock>;
+using StubGMock = detail::Mock<testing::StubGMock>;
 
 BOOST_DI_NAMESPACE_END
 
@@ -8,25 +8,73 @@
 #pragma once
 
 #include <gmock/gmock.h>
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <typeinfo>
 #include <unordered_map>
+#include <vector>
 #include "GUnit/Detail/Preprocessor.h"
 #include "GUnit/Detail/TypeTraits.h"
 #include "GUnit/Detail/Utility.h"
 
+#if !defined(GUNIT_SPY_CAPACITY)
+#define GUNIT_SPY_CAPACITY 1024
+#endif
+
+#if !defined(GUNIT_SPY_ARGS_SIZE)
+#define GUNIT_SPY_ARGS_SIZE 64
+#endif
+
+#if !defined(GUNIT_DEFERRED_SYMBOLIZATION)
+#define GUNIT_DEFERRED_SYMBOLIZATION 0
+#endif
+
+#if !defined(GUNIT_UNINTERESTING_SLOTS)
+#define GUNIT_UNINTERESTING_SLOTS 64
+#endif
+
 #if defined(__clang__)
-#pragma clang optimize off
 #pragma clang diagnostic ignored "-Wgnu-zero-variadic-macro-arguments"
+#define __GMOCK_NO_OPTIMIZE __attribute__((noinline, optnone))
 #elif defined(__GNUC__)
 #pragma GCC system_header
-#pragma GCC push_options
-#pragma GCC optimize("O0")
+#define __GMOCK_NO_OPTIMIZE __attribute__((noinline, optimize("O0")))
 #endif
 
+#if defined(__x86_64__) && defined(__ELF__)
+/**
+ * Call of a StubGMock method which isn't stubbed, its signature is unknown
+ * Zeroes all System V x86-64 result registers (rax:rdx, xmm0:xmm1), hence any result returned in registers is zero
+ */
+// clang-format off
+__asm__(
+  ".pushsection .text.__gmock_stub_zero,\"axG\",@progbits,__gmock_stub_zero,comdat\n"
+  ".weak __gmock_stub_zero\n"
+  ".type __gmock_stub_zero, @function\n"
+  "__gmock_stub_zero:\n"
+  "  xorl %eax, %eax\n"
+  "  xorl %edx, %edx\n"
+  "  xorps %xmm0, %xmm0\n"
+  "  xorps %xmm1, %xmm1\n"
+  "  ret\n"
+  ".size __gmock_stub_zero, .-__gmock_stub_zero\n"
+  ".popsection\n");
+// clang-format on
+#endif
+extern "C" void __gmock_stub_zero();
+
 namespace testing {
 namespace internal {
 template <class R, class... TArgs>
@@ -61,76 +109,50 @@ struct Function<R(TArgs...)> {
 inline namespace v1 {
 namespace detail {
 
-// clang-format off
 /**
- * Credits goes to the authors of HippoMocks/FakeIt
+ * Itanium C++ ABI - pointer to a virtual member function is {1 + vtable offset in bytes, this adjustment}
+ * ARM C++ ABI - {vtable offset in bytes, 2 * this adjustment + 1}
  */
-struct virtual_offset {
-  std::size_t offset;
-  virtual std::size_t offset0(int) { return offset = 0; }     virtual std::size_t offset1(int) { return offset = 1; }     virtual std::size_t offset2(int) { return offset = 2; }
-  virtual std::size_t offset3(int) { return offset = 3; }     virtual std::size_t offset4(int) { return offset = 4; }     virtual std::size_t offset5(int) { return offset = 5; }
-  virtual std::size_t offset6(int) { return offset = 6; }     virtual std::size_t offset7(int) { return offset = 7; }     virtual std::size_t offset8(int) { return offset = 8; }
-  virtual std::size_t offset9(int) { return offset = 9; }     virtual std::size_t offset10(int) { return offset = 10; }   virtual std::size_t offset11(int) { return offset = 11; }
-  virtual std::size_t offset12(int) { return offset = 12; }   virtual std::size_t offset13(int) { return offset = 13; }   virtual std::size_t offset14(int) { return offset = 14; }
-  virtual std::size_t offset15(int) { return offset = 15; }   virtual std::size_t offset16(int) { return offset = 16; }   virtual std::size_t offset17(int) { return offset = 17; }
-  virtual std::size_t offset18(int) { return offset = 18; }   virtual std::size_t offset19(int) { return offset = 19; }   virtual std::size_t offset20(int) { return offset = 20; }
-  virtual std::size_t offset21(int) { return offset = 21; }   virtual std::size_t offset22(int) { return offset = 22; }   virtual std::size_t offset23(int) { return offset = 23; }
-  virtual std::size_t offset24(int) { return offset = 24; }   virtual std::size_t offset25(int) { return offset = 25; }   virtual std::size_t offset26(int) { return offset = 26; }
-  virtual std::size_t offset27(int) { return offset = 27; }   virtual std::size_t offset28(int) { return offset = 28; }   virtual std::size_t offset29(int) { return offset = 29; }
-  virtual std::size_t offset30(int) { return offset = 30; }   virtual std::size_t offset31(int) { return offset = 31; }   virtual std::size_t offset32(int) { return offset = 32; }
-  virtual std::size_t offset33(int) { return offset = 33; }   virtual std::size_t offset34(int) { return offset = 34; }   virtual std::size_t offset35(int) { return offset = 35; }
-  virtual std::size_t offset36(int) { return offset = 36; }   virtual std::size_t offset37(int) { return offset = 37; }   virtual std::size_t offset38(int) { return offset = 38; }
-  virtual std::size_t offset39(int) { return offset = 39; }   virtual std::size_t offset40(int) { return offset = 40; }   virtual std::size_t offset41(int) { return offset = 41; }
-  virtual std::size_t offset42(int) { return offset = 42; }   virtual std::size_t offset43(int) { return offset = 43; }   virtual std::size_t offset44(int) { return offset = 44; }
-  virtual std::size_t offset45(int) { return offset = 45; }   virtual std::size_t offset46(int) { return offset = 46; }   virtual std::size_t offset47(int) { return offset = 47; }
-  virtual std::size_t offset48(int) { return offset = 48; }   virtual std::size_t offset49(int) { return offset = 49; }   virtual std::size_t offset50(int) { return offset = 50; }
-  virtual std::size_t offset51(int) { return offset = 51; }   virtual std::size_t offset52(int) { return offset = 52; }   virtual std::size_t offset53(int) { return offset = 53; }
-  virtual std::size_t offset54(int) { return offset = 54; }   virtual std::size_t offset55(int) { return offset = 55; }   virtual std::size_t offset56(int) { return offset = 56; }
-  virtual std::size_t offset57(int) { return offset = 57; }   virtual std::size_t offset58(int) { return offset = 58; }   virtual std::size_t offset59(int) { return offset = 59; }
-  virtual std::size_t offset60(int) { return offset = 60; }   virtual std::size_t offset61(int) { return offset = 61; }   virtual std::size_t offset62(int) { return offset = 62; }
-  virtual std::size_t offset63(int) { return offset = 63; }   virtual std::size_t offset64(int) { return offset = 64; }   virtual std::size_t offset65(int) { return offset = 65; }
-  virtual std::size_t offset66(int) { return offset = 66; }   virtual std::size_t offset67(int) { return offset = 67; }   virtual std::size_t offset68(int) { return offset = 68; }
-  virtual std::size_t offset69(int) { return offset = 69; }   virtual std::size_t offset70(int) { return offset = 70; }   virtual std::size_t offset71(int) { return offset = 71; }
-  virtual std::size_t offset72(int) { return offset = 72; }   virtual std::size_t offset73(int) { return offset = 73; }   virtual std::size_t offset74(int) { return offset = 74; }
-  virtual std::size_t offset75(int) { return offset = 75; }   virtual std::size_t offset76(int) { return offset = 76; }   virtual std::size_t offset77(int) { return offset = 77; }
-  virtual std::size_t offset78(int) { return offset = 78; }   virtual std::size_t offset79(int) { return offset = 79; }   virtual std::size_t offset80(int) { return offset = 80; }
-  virtual std::size_t offset81(int) { return offset = 81; }   virtual std::size_t offset82(int) { return offset = 82; }   virtual std::size_t offset83(int) { return offset = 83; }
-  virtual std::size_t offset84(int) { return offset = 84; }   virtual std::size_t offset85(int) { return offset = 85; }   virtual std::size_t offset86(int) { return offset = 86; }
-  virtual std::size_t offset87(int) { return offset = 87; }   virtual std::size_t offset88(int) { return offset = 88; }   virtual std::size_t offset89(int) { return offset = 89; }
-  virtual std::size_t offset90(int) { return offset = 90; }   virtual std::size_t offset91(int) { return offset = 91; }   virtual std::size_t offset92(int) { return offset = 92; }
-  virtual std::size_t offset93(int) { return offset = 93; }   virtual std::size_t offset94(int) { return offset = 94; }   virtual std::size_t offset95(int) { return offset = 95; }
-  virtual std::size_t offset96(int) { return offset = 96; }   virtual std::size_t offset97(int) { return offset = 97; }   virtual std::size_t offset98(int) { return offset = 98; }
-  virtual std::size_t offset99(int) { return offset = 99; }   virtual std::size_t offset100(int) { return offset = 100; } virtual std::size_t offset101(int) { return offset = 101; }
-  virtual std::size_t offset102(int) { return offset = 102; } virtual std::size_t offset103(int) { return offset = 103; } virtual std::size_t offset104(int) { return offset = 104; }
-  virtual std::size_t offset105(int) { return offset = 105; } virtual std::size_t offset106(int) { return offset = 106; } virtual std::size_t offset107(int) { return offset = 107; }
-  virtual std::size_t offset108(int) { return offset = 108; } virtual std::size_t offset109(int) { return offset = 109; } virtual std::size_t offset110(int) { return offset = 110; }
-  virtual std::size_t offset111(int) { return offset = 111; } virtual std::size_t offset112(int) { return offset = 112; } virtual std::size_t offset113(int) { return offset = 113; }
-  virtual std::size_t offset114(int) { return offset = 114; } virtual std::size_t offset115(int) { return offset = 115; } virtual std::size_t offset116(int) { return offset = 116; }
-  virtual std::size_t offset117(int) { return offset = 117; } virtual std::size_t offset118(int) { return offset = 118; } virtual std::size_t offset119(int) { return offset = 119; }
-  virtual std::size_t offset120(int) { return offset = 120; } virtual std::size_t offset121(int) { return offset = 121; } virtual std::size_t offset122(int) { return offset = 122; }
-  virtual std::size_t offset123(int) { return offset = 123; } virtual std::size_t offset124(int) { return offset = 124; } virtual std::size_t offset125(int) { return offset = 125; }
-  virtual std::size_t offset126(int) { return offset = 126; } virtual std::size_t offset127(int) { return offset = 127; }
-  virtual ~virtual_offset() = default;
+struct mem_fn_ptr {
+  std::uintptr_t ptr;
+  std::ptrdiff_t adj;
 };
-// clang-format on
+
+template <class TMemFn>
+inline std::size_t mem_fn_offset(TMemFn f) {
+  const auto mem_fn = union_cast<mem_fn_ptr>(f);
+#if defined(__arm__) || defined(__aarch64__)
+  return mem_fn.ptr / sizeof(void *);
+#else
+  return (mem_fn.ptr - 1) / sizeof(void *);
+#endif
+}
 
 template <class R, class B, class... TArgs>
 inline auto offset(R (B::*f)(TArgs...) const) {
-  auto ptr = reinterpret_cast<std::size_t (virtual_offset::*)(int)>(f);
-  return (virtual_offset{}.*ptr)(0);
+  return mem_fn_offset(f);
 }
 
 template <class R, class B, class... TArgs>
 inline auto offset(R (B::*f)(TArgs...)) {
-  auto ptr = reinterpret_cast<std::size_t (virtual_offset::*)(int)>(f);
-  return (virtual_offset{}.*ptr)(0);
+  return mem_fn_offset(f);
 }
 
+struct dtor_probe {
+  void **vptr;
+  bool upper;
+
+  static void lower_half(dtor_probe *self) { self->upper = false; }
+  static void upper_half(dtor_probe *self) { self->upper = true; }
+};
+
+/**
+ * Virtual call of `~T()` on a foreign object is only valid as compiled literally,
+ * hence it's never inlined nor optimized (unlike the rest of GMock)
+ */
 template <class T>
-inline auto dtor_offset() {
-  virtual_offset offset;
-  union_cast<T *>(&offset)->~T();
-  return offset.offset;
+__GMOCK_NO_OPTIMIZE void destroy(void *object) {
+  static_cast<T *>(object)->~T();
 }
 
 template <class T>
@@ -141,60 +163,351 @@ inline auto vtable_size() {
   return offset(&derrived::vtable_end);
 }
 
+/**
+ * Destructor can't be addressed, its slot is found by calling it through a vtable of probes (binary search)
+ */
+template <class T>
+inline std::size_t dtor_offset() {
+  constexpr auto OFFSET_SIZE = 2u;
+  std::vector<void *> probes(OFFSET_SIZE + vtable_size<T>());
+  dtor_probe probe{probes.data() + OFFSET_SIZE, false};
+  std::size_t first = 0, last = probes.size() - OFFSET_SIZE;
+  while (last - first > 1) {
+    const auto middle = first + (last - first) / 2;
+    std::fill(probe.vptr + first, probe.vptr + middle, union_cast<void *>(&dtor_probe::lower_half));
+    std::fill(probe.vptr + middle, probe.vptr + last, union_cast<void *>(&dtor_probe::upper_half));
+    destroy<T>(&probe);
+    (probe.upper ? first : last) = middle;
+  }
+  return first;
+}
+
 /**
  * Itanium C++ ABI - https://mentorembedded.github.io/cxx-abi/abi.html
+ * Copying a vtable which was made `shared` doesn't allocate, slots are copied on the first write
  * @tparam T interface type
  */
 template <class T>
 class vtable {
   static constexpr auto OFFSET_SIZE = 2u;
   static constexpr auto COOKIES_SIZE = 2u;
+  static constexpr auto HEADER_SIZE = OFFSET_SIZE + COOKIES_SIZE;
+
+  struct layout {
+    std::size_t size = vtable_size<T>();
+    std::size_t dtor = dtor_offset<T>();
+  };
 
  public:
-  vtable(void *f, void *dtor) : vptr{make_vtable()} {
-    for (auto i = 0u; i < vtable_size<T>(); ++i) {
-      set(i, f);
+  /**
+   * @param slots functions of the first `size` slots, the remaining ones are set to `f`
+   */
+  vtable(void *f, void *dtor, void *const *slots = nullptr, std::size_t size = 0) : vptr{make_vtable()} {
+    for (auto i = 0u; i < get_layout().size; ++i) {
+      set(i, i < size ? slots[i] : f);
     }
     set(dtor);
   }
-  vtable(vtable &&) = default;
-  vtable(const vtable &) = delete;
+  vtable(vtable &&other) noexcept : vptr{other.vptr} { other.vptr = nullptr; }
+  vtable(const vtable &other) : vptr{other.is_shared() ? other.vptr : clone(other.vptr)} {}
   ~vtable() {
-    vptr -= OFFSET_SIZE + COOKIES_SIZE;
-    delete[] vptr;
+    if (vptr && !is_shared()) {
+      delete[](vptr - HEADER_SIZE);
+    }
   }
 
-  void set(std::size_t offset, void *f) { vptr[offset] = f; }
+  /**
+   * Prototype vtable which is never released nor modified, copies of it share its slots
+   */
+  static vtable shared(void *f, void *dtor, void *const *slots = nullptr, std::size_t size = 0) {
+    vtable vt{f, dtor, slots, size};
+    vt.cookie() = vt.vptr;
+    return vt;
+  }
+
+  void set(std::size_t offset, void *f) {
+    if (is_shared()) {
+      vptr = clone(vptr);
+    }
+    vptr[offset] = f;
+  }
   void set(void *f) {
-    const auto offset = dtor_offset<T>();
+    const auto offset = get_layout().dtor;
     const auto ptr = union_cast<void *>(&vtable<T>::dtor);
     vptr[offset] = f;        // non-deleting dtor
     vptr[offset + 1] = ptr;  // deleting dtor
   }
   auto get(std::size_t offset) const { return vptr[offset]; }
+  auto is_shared() const { return cookie() == vptr; }
 
  private:
+  void *&cookie() const { return (vptr - HEADER_SIZE)[1]; }
+
+  static const layout &get_layout() {
+    static const layout l{};
+    return l;
+  }
+
   auto dtor(int) {
     auto *self = (T *)this;
     auto vt = (vtable *)self;
-    auto offset = dtor_offset<T>();
-    auto ptr = vt->get(offset);
+    auto ptr = vt->get(get_layout().dtor);
     void (*f)(T *) = union_cast<void (*)(T *)>(ptr);
     f(self);
     return 0;
   }
 
   static auto make_vtable() {
-    const auto size = vtable_size<T>();
-    auto vptr = new void *[size + OFFSET_SIZE + COOKIES_SIZE]{};
+    auto vptr = new void *[get_layout().size + HEADER_SIZE]{};
     vptr[0] = const_cast<std::type_info *>(&typeid(T));
-    vptr += COOKIES_SIZE + OFFSET_SIZE;
+    vptr += HEADER_SIZE;
+    return vptr;
+  }
+
+  static auto clone(void **other) {
+    auto vptr = make_vtable();
+    std::copy(other, other + get_layout().size, vptr);
     return vptr;
   }
 
   void **vptr = nullptr;
 };
 
+/**
+ * Vtable offset of the mocked method of `T` identified by the hash of its name (fnv1a)
+ * Set by the first EXPECT_CALL/ON_CALL, read on every mocked call
+ */
+template <class T, std::uint64_t Name>
+struct method {
+  static std::size_t offset;
+};
+
+template <class T, std::uint64_t Name>
+std::size_t method<T, Name>::offset;
+
+/**
+ * Mocked call recorded by ConcurrentGMock, replayed into gmock on verification
+ */
+class recorded_call {
+ public:
+  virtual ~recorded_call() = default;
+  virtual void replay() = 0;
+};
+
+template <class TF>
+class recorded_call_impl : public recorded_call {
+ public:
+  explicit recorded_call_impl(TF f) : f(std::move(f)) {}
+  void replay() override { f(); }
+
+ private:
+  TF f;
+};
+
+template <class TF>
+recorded_call *record(arena &arena, TF f) {
+  return arena.make<recorded_call_impl<TF>>(std::move(f));
+}
+
+struct expectation_actions : internal::ExpectationBase {
+  using internal::ExpectationBase::repeated_action_specified_;
+  using internal::ExpectationBase::untyped_actions_;
+};
+
+struct mocker_actions : internal::UntypedFunctionMockerBase {
+  using internal::UntypedFunctionMockerBase::untyped_expectations_;
+  using internal::UntypedFunctionMockerBase::untyped_on_call_specs_;
+};
+
+/**
+ * Whether actions (WillOnce, WillRepeatedly, ON_CALL) are attached to the mocked method
+ */
+inline bool has_actions(const internal::UntypedFunctionMockerBase &f) {
+  const auto &expectations = f.*(&mocker_actions::untyped_expectations_);
+  return !(f.*(&mocker_actions::untyped_on_call_specs_)).empty() ||
+         std::any_of(expectations.begin(), expectations.end(), [](const auto &expectation) {
+           return !((*expectation).*(&expectation_actions::untyped_actions_)).empty() ||
+                  (*expectation).*(&expectation_actions::repeated_action_specified_);
+         });
+}
+
+/**
+ * Arguments are stored by SpyGMock, references to objects which can't be copied are stored as references
+ */
+template <class T, class TDecay = std::decay_t<T>>
+using spy_arg_t =
+    std::conditional_t<!std::is_reference<T>::value || (std::is_copy_constructible<TDecay>::value && !std::is_abstract<TDecay>::value),
+                       TDecay, std::reference_wrapper<std::remove_reference_t<T>>>;
+
+/**
+ * Call recorded by SpyGMock, arguments are stored in place when they fit
+ */
+class spy_record {
+ public:
+  spy_record() = default;
+  spy_record(const spy_record &) = delete;
+  ~spy_record() { reset(); }
+
+  template <class... TArgs>
+  void set(std::size_t offset, TArgs &&... args) {
+    using args_t = std::tuple<spy_arg_t<TArgs>...>;
+    reset();
+    this->offset = offset;
+    this->time = std::chrono::steady_clock::now();
+    if (sizeof(args_t) <= sizeof(storage) && alignof(args_t) <= alignof(std::max_align_t)) {
+      this->args = new (storage) args_t{std::forward<TArgs>(args)...};
+      this->destroy = [](void *args) { static_cast<args_t *>(args)->~args_t(); };
+    } else {
+      this->args = new args_t{std::forward<TArgs>(args)...};
+      this->destroy = [](void *args) { delete static_cast<args_t *>(args); };
+    }
+  }
+
+  void reset() {
+    if (args) {
+      destroy(args);
+      args = nullptr;
+    }
+  }
+
+  template <class... TArgs>
+  auto &get() {
+    return *static_cast<std::tuple<spy_arg_t<TArgs>...> *>(args);
+  }
+
+  std::size_t offset = 0;
+  std::chrono::steady_clock::time_point time{};
+
+ private:
+  void *args = nullptr;
+  void (*destroy)(void *) = nullptr;
+  alignas(std::max_align_t) byte storage[GUNIT_SPY_ARGS_SIZE];
+};
+
+template <class TSpy, class... TArgs>
+class spy_expectation {
+ public:
+  spy_expectation(const TSpy &spy, std::size_t offset, const Matcher<TArgs> &... matchers)
+      : spy(spy), offset(offset), matchers{matchers...} {}
+  spy_expectation(spy_expectation &&) = default;
+
+  ~spy_expectation() noexcept(false) {
+    if (!file) {
+      return;
+    }
+
+    auto calls = 0u;
+    spy.for_each([&](spy_record &record) {
+      if (record.offset == offset && matches(record.template get<TArgs...>(), std::make_index_sequence<sizeof...(TArgs)>{})) {
+        ++calls;
+      }
+    });
+
+    if (!cardinality.IsSatisfiedByCallCount(calls)) {
+      std::stringstream msg;
+      msg << "Spied call: " << obj << "." << call << "\n    Expected: to be ";
+      cardinality.DescribeTo(&msg);
+      msg << "\n      Actual: ";
+      Cardinality::DescribeActualCallCountTo(calls, &msg);
+      if (!spy.spied(offset)) {
+        msg << "\n        Note: method is not spied, see SPY";
+      }
+      if (spy.lost()) {
+        msg << "\n        Note: " << spy.lost() << " call(s) were not recorded (capacity: " << spy.capacity() << ")";
+      }
+      ADD_FAILURE_AT(file, line) << msg.str();
+    }
+  }
+
+  spy_expectation &At(const char *file, int line, const char *obj, const char *call) {
+    this->file = file;
+    this->line = line;
+    this->obj = obj;
+    this->call = call;
+    return *this;
+  }
+
+  spy_expectation &Times(const Cardinality &cardinality) {
+    this->cardinality = cardinality;
+    return *this;
+  }
+  spy_expectation &Times(int n) { return Times(Exactly(n)); }
+
+ private:
+  template <class TTuple, std::size_t... Ns>
+  bool matches(TTuple &args, std::index_sequence<Ns...>) const {
+    bool result = true;
+    (void)std::initializer_list<int>{(result = result && std::get<Ns>(matchers).Matches(std::get<Ns>(args)), 0)...};
+    return result;
+  }
+
+  const TSpy &spy;
+  std::size_t offset = 0;
+  std::tuple<Matcher<TArgs>...> matchers;
+  Cardinality cardinality = AtLeast(1);
+  const char *file = nullptr;
+  int line = 0;
+  const char *obj = "";
+  const char *call = "";
+};
+
+inline std::size_t next_mock_id() {
+  static std::atomic<std::size_t> id{};
+  return ++id;
+}
+
+/**
+ * Number of calls of mocked methods (all mocks), reported per SHOULD
+ * Counted per thread, so calls don't share a cache line, and summed up by `total`
+ */
+class mock_calls {
+  struct alignas(64) counter {
+    std::atomic<std::size_t> calls{};
+  };
+
+  struct registry {
+    std::mutex mutex;
+    std::vector<counter *> counters;
+    std::size_t retired = 0;  // calls of finished threads
+  };
+
+  static registry &instance() {
+    static auto *self = new registry{};  // outlives thread_local counters
+    return *self;
+  }
+
+  struct thread_counter : counter {
+    thread_counter() {
+      auto &r = instance();
+      std::lock_guard<std::mutex> lock{r.mutex};
+      r.counters.push_back(this);
+    }
+
+    ~thread_counter() {
+      auto &r = instance();
+      std::lock_guard<std::mutex> lock{r.mutex};
+      r.retired += calls.load(std::memory_order_relaxed);
+      r.counters.erase(std::find(r.counters.begin(), r.counters.end(), this));
+    }
+  };
+
+ public:
+  static void add() {
+    thread_local thread_counter counter;
+    counter.calls.store(counter.calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);  // written by this thread only
+  }
+
+  static std::size_t total() {
+    auto &r = instance();
+    std::lock_guard<std::mutex> lock{r.mutex};
+    auto total = r.retired;
+    for (const auto *counter : r.counters) {
+      total += counter->calls.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+};
+
 using CallReactionType = internal::CallReaction (*)(const void *);
 template <CallReactionType Ptr>
 struct GetAccess {
@@ -202,6 +515,107 @@ struct GetAccess {
 };
 CallReactionType GetCallReaction();
 template struct GetAccess<&Mock::GetReactionOnUninterestingCalls>;
+
+using SetCallReactionType = void (*)(const void *);
+template <SetCallReactionType Allow, SetCallReactionType Warn, SetCallReactionType Fail, SetCallReactionType Unregister>
+struct SetAccess {
+  friend void SetCallReaction(const void *mock, internal::CallReaction reaction) {
+    switch (reaction) {
+      case internal::CallReaction::kAllow:
+        return Allow(mock);
+      case internal::CallReaction::kFail:
+        return Fail(mock);
+      default:
+        return Warn(mock);
+    }
+  }
+  friend void UnregisterCallReaction(const void *mock) { Unregister(mock); }
+};
+void SetCallReaction(const void *, internal::CallReaction);
+void UnregisterCallReaction(const void *);
+template struct SetAccess<&Mock::AllowUninterestingCalls, &Mock::WarnUninterestingCalls, &Mock::FailUninterestingCalls,
+                          &Mock::UnregisterCallReaction>;
+
+/**
+ * Reactions on uninteresting calls are changed through GUnit, so that mocks re-read theirs only when the epoch changes
+ * Only GUnit's setters are supported, a reaction set directly through gmock (Mock::AllowUninterestingCalls, ...,
+ * e.g. by gmock's NiceMock of a class derived from GMock) is seen only until the first uninteresting call of the mock
+ */
+inline std::atomic<std::size_t> &call_reaction_epoch() {
+  static std::atomic<std::size_t> epoch{1};
+  return epoch;
+}
+
+inline void set_call_reaction(const void *mock, internal::CallReaction reaction) {
+  SetCallReaction(mock, reaction);
+  call_reaction_epoch().fetch_add(1, std::memory_order_release);
+}
+
+inline void unregister_call_reaction(const void *mock) {
+  UnregisterCallReaction(mock);
+  call_reaction_epoch().fetch_add(1, std::memory_order_release);
+}
+
+inline std::string source_info(const std::string &file, int line) {
+  return source_line(file, line).str() + "\n\t       At: [" + basename(file) + ":" + std::to_string(line) + "]";
+}
+
+/**
+ * Uninteresting calls recorded as raw addresses (GUNIT_DEFERRED_SYMBOLIZATION)
+ * Symbolized in a single pass at the end of a failed test, dropped otherwise
+ */
+class uninteresting_calls : public EmptyTestEventListener {
+  struct call {
+    void *addr = nullptr;
+    int frames = 0;
+    void *stack[GUNIT_SHOW_STACK_SIZE] = {};
+  };
+
+ public:
+  static uninteresting_calls &instance() {
+    static auto *self = [] {
+      auto *listener = new uninteresting_calls{};
+      UnitTest::GetInstance()->listeners().Append(listener);  // takes ownership
+      return listener;
+    }();
+    return *self;
+  }
+
+  const char *record(const void *ret) {
+    call c;
+    c.addr = (void *)((const char *)ret - 1);
+    c.frames = backtrace_from(ret, c.stack, GUNIT_SHOW_STACK_SIZE);
+    std::lock_guard<std::mutex> lock{mutex};
+    calls.push_back(c);
+    return "uninteresting call (symbolized if the test fails)";
+  }
+
+  void OnTestEnd(const TestInfo &info) override {
+    std::lock_guard<std::mutex> lock{mutex};
+    if (info.result()->Failed()) {
+      report();
+    }
+    calls.clear();
+  }
+
+ private:
+  void report() const {
+    std::vector<void *> addrs;
+    addrs.reserve(calls.size());
+    for (const auto &c : calls) {
+      addrs.push_back(c.addr);
+    }
+
+    const auto locations = addr2line(addrs);
+    for (auto i = 0u; i < calls.size(); ++i) {
+      std::cout << "[ GMOCK    ] Uninteresting call: " << source_info(locations[i].first, locations[i].second)
+                << "\n\t     From: " << call_stack(calls[i].stack, calls[i].frames, "\n\t\t   ") << std::endl;
+    }
+  }
+
+  std::mutex mutex;
+  std::vector<call> calls;
+};
 }  // detail
 
 template <class T>
@@ -213,71 +627,127 @@ class GMock {
   detail::vtable<T> vtable;
   detail::byte _[sizeof(T)] = {0};
 
+  void *not_expected() { return uninteresting_call(UNKNOWN_SLOT, __builtin_return_address(0)); }
+
+  template <std::size_t N>
+  void *not_expected_at() {
+    return uninteresting_call(N, __builtin_return_address(0));
+  }
+
+  template <std::size_t... Ns>
+  static auto not_expected_slots(std::index_sequence<Ns...>) {
+    return std::array<void *, sizeof...(Ns)>{{detail::union_cast<void *>(&GMock::template not_expected_at<Ns>)...}};
+  }
+
+  /**
+   * Each of the first GUNIT_UNINTERESTING_SLOTS slots has its own thunk, so uninteresting calls know their slot
+   */
+  static const detail::vtable<T> &prototype() {
+    static const auto slots = not_expected_slots(std::make_index_sequence<GUNIT_UNINTERESTING_SLOTS>{});
+    static const auto vt =
+        detail::vtable<T>::shared(detail::union_cast<void *>(&GMock::not_expected), detail::union_cast<void *>(&GMock::expected),
+                                  slots.data(), slots.size());
+    return vt;
+  }
+
+ protected:
+  explicit GMock(const detail::vtable<T> &vt) : vtable{vt} {}
+
+  static constexpr auto UNKNOWN_SLOT = std::size_t(-1);
+
   void expected() {}
-  void *not_expected() {
-    const auto addr = (volatile int *)__builtin_return_address(0) - 1;
-    auto *ptr = [this] {
-      fs[__PRETTY_FUNCTION__] = std::make_unique<FunctionMocker<void *()>>();
-      return static_cast<FunctionMocker<void *()> *>(fs[__PRETTY_FUNCTION__].get());
-    }();
 
-    if (internal::CallReaction::kAllow == detail::GetCallReaction()(internal::ImplicitCast_<GMock<T> *>(this))) {
-      ptr->SetOwnerAndName(this, __PRETTY_FUNCTION__);
-    } else {
-      const auto info = [](const std::string &file, int line) {
-        std::ifstream input(file);
-        std::string buf;
-        for (auto i = 0; i < line; ++i) getline(input, buf);
-        detail::trim(buf);
-        return buf + "\n\t       At: [" + detail::basename(file) + ":" + std::to_string(line) + "]";
-      };
-      const auto al = detail::addr2line((void *)addr);
-      msgs.emplace_back(info(al.first, al.second) + "\n\t     From: " + detail::call_stack("\n\t\t   ", 2));
-      ptr->SetOwnerAndName(this, msgs.back().c_str());
+  /**
+   * Reaction on uninteresting calls is queried again only after it was changed (detail::set_call_reaction)
+   * Each call site is symbolized once, kWarn is reported once per call site, kFail on every call
+   */
+  void *uninteresting_call(std::size_t slot, const void *ret) {
+    detail::mock_calls::add();
+    const auto epoch = detail::call_reaction_epoch().load(std::memory_order_acquire);
+    if (reaction_epoch != epoch) {
+      reaction = detail::GetCallReaction()(internal::ImplicitCast_<GMock<T> *>(this));
+      reaction_epoch = epoch;
+    }
+
+    if (reaction == internal::CallReaction::kAllow) {
+      return nullptr;
+    }
+
+    auto &site = sites[ret];
+    if (site) {
+      return reaction == internal::CallReaction::kWarn ? nullptr : site->Invoke();
     }
-    return ptr->Invoke();
+
+    site = arena.make<FunctionMocker<void *()>>();
+    const auto name = slot == UNKNOWN_SLOT ? std::string{} : "[slot " + std::to_string(slot) + "] ";
+#if GUNIT_DEFERRED_SYMBOLIZATION
+    const auto *msg = arena.make<std::string>(name + detail::uninteresting_calls::instance().record(ret));
+#else
+    void *bt[GUNIT_SHOW_STACK_SIZE];
+    const auto frames = detail::backtrace_from(ret, bt, GUNIT_SHOW_STACK_SIZE);
+    const auto al = detail::addr2line((void *)((const char *)ret - 1));
+    const auto *msg = arena.make<std::string>(name + detail::source_info(al.first, al.second) + "\n\t     From: " +
+                                              detail::call_stack(bt, frames, "\n\t\t   "));
+#endif
+    site->SetOwnerAndName(this, msg->c_str());
+    return site->Invoke();
   }
 
-  template <class TName, class R, class... TArgs>
-  decltype(auto) gmock_call_impl(int offset, const detail::identity_t<Matcher<TArgs>> &... args) {
-    vtable.set(offset, detail::union_cast<void *>(&GMock::template original_call<TName, R, TArgs...>));
+  void set_call(std::size_t offset, void *call) { vtable.set(offset, call); }
 
-    const auto it = fs.find(TName::c_str());
-    auto *ptr = [&it, this] {
-      if (it == fs.end()) {
-        fs[TName::c_str()] = std::make_unique<FunctionMocker<R(TArgs...)>>();
-        return static_cast<FunctionMocker<R(TArgs...)> *>(fs[TName::c_str()].get());
-      }
-      return static_cast<FunctionMocker<R(TArgs...)> *>(it->second.get());
-    }();
+  /**
+   * Instantiated per signature, only `call` (dispatching to the mocker) is instantiated per method name
+   */
+  template <class R, class... TArgs>
+  decltype(auto) gmock_call_impl(std::size_t offset, void *call, const char *name,
+                                 const detail::identity_t<Matcher<TArgs>> &... args) {
+    set_call(offset, call);
+
+    if (offset >= fs.size()) {
+      fs.resize(offset + 1);
+    }
 
-    ptr->RegisterOwner(this);
-    return ptr->With(args...);
+    return mocker<R(TArgs...)>(offset, name).With(args...);
   }
 
-  template <class TName, class R, class... TArgs>
+  template <class F>
+  FunctionMocker<F> &mocker(std::size_t offset, const char *name = nullptr) {
+    if (!fs[offset]) {
+      fs[offset] = arena.make<FunctionMocker<F>>();
+      fs[offset]->RegisterOwner(this);
+      fs[offset]->SetOwnerAndName(this, name);
+    }
+    return static_cast<FunctionMocker<F> &>(*fs[offset]);
+  }
+
+ private:
+  template <std::uint64_t Name, class R, class... TArgs>
   R original_call(TArgs... args) {
-    auto *f = static_cast<FunctionMocker<R(TArgs...)> *>(fs[TName::c_str()].get());
-    f->SetOwnerAndName(this, TName::c_str());
-    return f->Invoke(args...);
+    detail::mock_calls::add();
+    return static_cast<FunctionMocker<R(TArgs...)> &>(*fs[detail::method<T, Name>::offset]).Invoke(args...);
   }
 
  public:
   using type = T;
 
-  GMock() : vtable{detail::union_cast<void *>(&GMock::not_expected), detail::union_cast<void *>(&GMock::expected)} {}
+  GMock() : vtable{prototype()} {}
   GMock(const GMock &) = delete;
   GMock(GMock &&) = default;
   ~GMock() noexcept = default;
 
-  template <class TName, class R, class B, class... TArgs>
-  decltype(auto) gmock_call(R (B::*f)(TArgs...), const detail::identity_t<Matcher<TArgs>> &... args) {
-    return gmock_call_impl<TName, R, TArgs...>(detail::offset(f), args...);
+  template <std::uint64_t Name, class R, class B, class... TArgs>
+  decltype(auto) gmock_call(const char *name, R (B::*f)(TArgs...), const detail::identity_t<Matcher<TArgs>> &... args) {
+    const auto offset = detail::method<T, Name>::offset = detail::offset(f);
+    return gmock_call_impl<R, TArgs...>(offset, detail::union_cast<void *>(&GMock::template original_call<Name, R, TArgs...>),
+                                        name, args...);
   }
 
-  template <class TName, class R, class B, class... TArgs>
-  decltype(auto) gmock_call(R (B::*f)(TArgs...) const, const typename detail::identity_t<Matcher<TArgs>> &... args) {
-    return gmock_call_impl<TName, R, TArgs...>(detail::offset(f), args...);
+  template <std::uint64_t Name, class R, class B, class... TArgs>
+  decltype(auto) gmock_call(const char *name, R (B::*f)(TArgs...) const,
+                            const typename detail::identity_t<Matcher<TArgs>> &... args) {
+    const auto offset = detail::method<T, Name>::offset = detail::offset(f);
+    return gmock_call_impl<R, TArgs...>(offset, detail::union_cast<void *>(&GMock::template original_call<Name, R, TArgs...>),
+                                        name, args...);
   }
 
   T &object() { return reinterpret_cast<T &>(*this); }
@@ -285,31 +755,337 @@ class GMock {
   explicit operator T &() { return object(); }
   explicit operator const T &() const { return object(); }
 
+ protected:
+  std::vector<internal::UntypedFunctionMockerBase *> fs;
+
  private:
-  std::unordered_map<std::string, std::unique_ptr<internal::UntypedFunctionMockerBase>> fs;
-  std::vector<std::string> msgs;
+  detail::arena arena;  // owns mockers (fs, sites), released at once on destruction
+  std::unordered_map<const void *, FunctionMocker<void *()> *> sites;
+  internal::CallReaction reaction = internal::CallReaction::kWarn;
+  std::size_t reaction_epoch = 0;
 };
 }  // v1
 
 template <class T>
 class NiceMock<GMock<T>> final : public GMock<T> {
  public:
-  NiceMock(NiceMock &&) = default;
+  NiceMock(NiceMock &&other) : GMock<T>{std::move(other)} { allow(); }
   NiceMock(const NiceMock &) = delete;
-  NiceMock() { Mock::AllowUninterestingCalls(internal::ImplicitCast_<GMock<T> *>(this)); }
-  ~NiceMock() { Mock::UnregisterCallReaction(internal::ImplicitCast_<GMock<T> *>(this)); }
+  NiceMock() { allow(); }
+  ~NiceMock() { detail::unregister_call_reaction(internal::ImplicitCast_<GMock<T> *>(this)); }
+
+ private:
+  void allow() { detail::set_call_reaction(internal::ImplicitCast_<GMock<T> *>(this), internal::CallReaction::kAllow); }
 };
 
 template <class T>
 class StrictMock<GMock<T>> final : public GMock<T> {
  public:
-  StrictMock(StrictMock &&) = default;
+  StrictMock(StrictMock &&other) : GMock<T>{std::move(other)} { fail(); }
   StrictMock(const StrictMock &) = delete;
-  StrictMock() { Mock::FailUninterestingCalls(internal::ImplicitCast_<GMock<T> *>(this)); }
-  ~StrictMock() { Mock::UnregisterCallReaction(internal::ImplicitCast_<GMock<T> *>(this)); }
+  StrictMock() { fail(); }
+  ~StrictMock() { detail::unregister_call_reaction(internal::ImplicitCast_<GMock<T> *>(this)); }
+
+ private:
+  void fail() { detail::set_call_reaction(internal::ImplicitCast_<GMock<T> *>(this), internal::CallReaction::kFail); }
 };
 
 inline namespace v1 {
+/**
+ * GMock for multithreaded SUTs
+ *  - expectations have to be set before the SUT threads are started, dispatch table is immutable afterwards
+ *  - calls don't lock, they are counted per method (atomic) and recorded into per-thread buffers
+ *    (the last 16 buffers used by a thread are cached, others are looked up under a lock)
+ *  - recorded calls are replayed into gmock (matchers, cardinalities, actions) by `replay` or on destruction,
+ *    which has to happen after the SUT threads are joined
+ *  - calls are time stamped and replayed in order, so sequences (InSequence, After) hold for calls of one mock,
+ *    but not across mocks, each of which is replayed on its own
+ *  - calls return DefaultValue<R> (see DefaultValue<R>::Set), attached actions (WillOnce, WillRepeatedly, ON_CALL)
+ *    fail the test on replay, as they can't be run at call time
+ *  - arguments passed by reference are recorded by reference
+ *  - recorded calls are allocated from per-thread arenas, released at once after replay
+ */
+template <class T>
+class ConcurrentGMock : public GMock<T> {
+  static constexpr auto MAX_CACHED_BUFFERS = 16;
+  struct buffer_t {
+    std::thread::id owner;
+    detail::arena arena;
+    std::vector<std::pair<std::chrono::steady_clock::time_point, detail::recorded_call *>> calls;
+  };
+
+  template <std::uint64_t Name, class R, class... TArgs>
+  R concurrent_call(TArgs... args) {
+    const auto offset = detail::method<T, Name>::offset;
+    detail::mock_calls::add();
+    counters[offset].fetch_add(1, std::memory_order_relaxed);
+    auto &f = static_cast<FunctionMocker<R(TArgs...)> &>(*this->fs[offset]);
+    record([&f, args = std::tuple<TArgs...>{std::forward<TArgs>(args)...}]() mutable {
+      replay_call(f, args, std::make_index_sequence<sizeof...(TArgs)>{});
+    });
+    return DefaultValue<R>::Get();
+  }
+
+  void *concurrent_not_expected() {
+    const auto ret = __builtin_return_address(0);
+    record([this, ret] { this->uninteresting_call(GMock<T>::UNKNOWN_SLOT, ret); });
+    return nullptr;
+  }
+
+  template <class TCall>
+  void record(TCall &&call) {
+    auto &buffer = this->buffer();
+    buffer.calls.emplace_back(std::chrono::steady_clock::now(), detail::record(buffer.arena, std::forward<TCall>(call)));
+  }
+
+  template <class F, class... TArgs, std::size_t... Ns>
+  static void replay_call(FunctionMocker<F> &f, std::tuple<TArgs...> &args, std::index_sequence<Ns...>) {
+    f.Invoke(std::forward<TArgs>(std::get<Ns>(args))...);
+  }
+
+  static const detail::vtable<T> &prototype() {
+    static const auto vt = detail::vtable<T>::shared(detail::union_cast<void *>(&ConcurrentGMock::concurrent_not_expected),
+                                                     detail::union_cast<void *>(&ConcurrentGMock::expected));
+    return vt;
+  }
+
+  buffer_t &buffer() {
+    thread_local std::vector<std::pair<std::size_t, buffer_t *>> cache;
+    for (const auto &cached : cache) {
+      if (cached.first == id) {
+        return *cached.second;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock{mutex};
+    const auto owner = std::this_thread::get_id();
+    auto it = std::find_if(buffers.begin(), buffers.end(), [owner](const auto &buffer) { return buffer->owner == owner; });
+    if (it == buffers.end()) {
+      buffers.push_back(std::make_unique<buffer_t>());
+      buffers.back()->owner = owner;
+      it = std::prev(buffers.end());
+    }
+    if (cache.size() == MAX_CACHED_BUFFERS) {
+      cache.erase(cache.begin());
+    }
+    cache.emplace_back(id, it->get());
+    return **it;
+  }
+
+ public:
+  ConcurrentGMock() : GMock<T>{prototype()}, counters{new std::atomic<std::size_t>[detail::vtable_size<T>()]()} {}
+  ConcurrentGMock(const ConcurrentGMock &) = delete;
+  ~ConcurrentGMock() { replay(); }
+
+  template <std::uint64_t Name, class R, class B, class... TArgs>
+  decltype(auto) gmock_call(const char *name, R (B::*f)(TArgs...), const detail::identity_t<Matcher<TArgs>> &... args) {
+    const auto offset = detail::method<T, Name>::offset = detail::offset(f);
+    return this->template gmock_call_impl<R, TArgs...>(
+        offset, detail::union_cast<void *>(&ConcurrentGMock::template concurrent_call<Name, R, TArgs...>), name, args...);
+  }
+
+  template <std::uint64_t Name, class R, class B, class... TArgs>
+  decltype(auto) gmock_call(const char *name, R (B::*f)(TArgs...) const,
+                            const typename detail::identity_t<Matcher<TArgs>> &... args) {
+    const auto offset = detail::method<T, Name>::offset = detail::offset(f);
+    return this->template gmock_call_impl<R, TArgs...>(
+        offset, detail::union_cast<void *>(&ConcurrentGMock::template concurrent_call<Name, R, TArgs...>), name, args...);
+  }
+
+  /**
+   * @return number of calls of the expected method `f` so far (safe to use while the SUT is running)
+   */
+  template <class TMemFn>
+  std::size_t calls(TMemFn f) const {
+    return counters[detail::offset(f)].load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Replays recorded calls into gmock in the order they were made
+   */
+  void replay() {
+    std::lock_guard<std::mutex> lock{mutex};
+    std::vector<std::pair<std::chrono::steady_clock::time_point, detail::recorded_call *>> calls;
+    for (const auto &buffer : buffers) {
+      calls.insert(calls.end(), buffer->calls.begin(), buffer->calls.end());
+    }
+    if (!calls.empty()) {
+      for (const auto *f : this->fs) {
+        if (f && detail::has_actions(*f)) {
+          ADD_FAILURE() << "ConcurrentGMock calls return DefaultValue<R>, actions of " << f->Name()
+                        << " can't be run at call time (use DefaultValue<R>::Set)";
+        }
+      }
+    }
+    std::stable_sort(calls.begin(), calls.end(), [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+    for (const auto &call : calls) {
+      call.second->replay();
+    }
+    for (auto &buffer : buffers) {
+      buffer->calls.clear();
+      buffer->arena.reset();
+    }
+  }
+
+ private:
+  const std::size_t id = detail::next_mock_id();
+  std::unique_ptr<std::atomic<std::size_t>[]> counters;
+  std::mutex mutex;
+  std::vector<std::unique_ptr<buffer_t>> buffers;
+};
+
+enum class SpyOverflow {
+  Overwrite,  // the oldest recorded call is overwritten
+  Discard     // calls are not recorded anymore
+};
+
+/**
+ * GMock recording calls of spied methods (SPY) into a preallocated ring buffer
+ *  - nothing is matched at call time, calls return DefaultValue<R>
+ *  - recorded calls are verified after the fact with EXPECT_CALLED
+ *  - calls of methods which are not spied are handled as by GMock
+ */
+template <class T>
+class SpyGMock : public GMock<T> {
+  template <std::uint64_t Name, class R, class... TArgs>
+  R spy_call(TArgs... args) {
+    detail::mock_calls::add();
+    if (auto *record = next()) {
+      record->template set<TArgs...>(detail::method<T, Name>::offset, std::forward<TArgs>(args)...);
+    }
+    return DefaultValue<R>::Get();
+  }
+
+  detail::spy_record *next() {
+    if (size == records.size()) {
+      ++lost_;
+      if (overflow == SpyOverflow::Discard) {
+        return nullptr;
+      }
+    } else {
+      ++size;
+    }
+    auto *record = &records[begin];
+    begin = (begin + 1) % records.size();
+    return record;
+  }
+
+  template <std::uint64_t Name, class R, class... TArgs>
+  void gmock_spy_impl(std::size_t offset) {
+    detail::method<T, Name>::offset = offset;
+    this->set_call(offset, detail::union_cast<void *>(&SpyGMock::template spy_call<Name, R, TArgs...>));
+    if (offset >= spied_.size()) {
+      spied_.resize(offset + 1);
+    }
+    spied_[offset] = true;
+  }
+
+ public:
+  explicit SpyGMock(std::size_t capacity = GUNIT_SPY_CAPACITY, SpyOverflow overflow = SpyOverflow::Overwrite)
+      : records(capacity ? capacity : 1), overflow(overflow) {}
+
+  template <std::uint64_t Name, class R, class B, class... TArgs>
+  void gmock_spy(R (B::*f)(TArgs...)) {
+    gmock_spy_impl<Name, R, TArgs...>(detail::offset(f));
+  }
+
+  template <std::uint64_t Name, class R, class B, class... TArgs>
+  void gmock_spy(R (B::*f)(TArgs...) const) {
+    gmock_spy_impl<Name, R, TArgs...>(detail::offset(f));
+  }
+
+  template <class R, class B, class... TArgs>
+  auto gmock_called(R (B::*f)(TArgs...), const detail::identity_t<Matcher<TArgs>> &... args) const {
+    return detail::spy_expectation<SpyGMock, TArgs...>{*this, detail::offset(f), args...};
+  }
+
+  template <class R, class B, class... TArgs>
+  auto gmock_called(R (B::*f)(TArgs...) const, const detail::identity_t<Matcher<TArgs>> &... args) const {
+    return detail::spy_expectation<SpyGMock, TArgs...>{*this, detail::offset(f), args...};
+  }
+
+  /**
+   * Visits recorded calls, oldest first
+   */
+  template <class TVisitor>
+  void for_each(TVisitor visitor) const {
+    const auto first = size == records.size() ? begin : 0;
+    for (auto i = 0u; i < size; ++i) {
+      visitor(records[(first + i) % records.size()]);
+    }
+  }
+
+  /**
+   * @return vtable offsets and times of recorded calls, oldest first
+   */
+  std::vector<std::pair<std::size_t, std::chrono::steady_clock::time_point>> history() const {
+    std::vector<std::pair<std::size_t, std::chrono::steady_clock::time_point>> result;
+    for_each([&result](const detail::spy_record &record) { result.emplace_back(record.offset, record.time); });
+    return result;
+  }
+
+  std::size_t capacity() const { return records.size(); }
+  std::size_t lost() const { return lost_; }
+  bool spied(std::size_t offset) const { return offset < spied_.size() && spied_[offset]; }
+
+  void clear() {
+    for (auto &record : records) {
+      record.reset();
+    }
+    begin = size = lost_ = 0;
+  }
+
+ private:
+  mutable std::vector<detail::spy_record> records;
+  SpyOverflow overflow = SpyOverflow::Overwrite;
+  std::size_t begin = 0;
+  std::size_t size = 0;
+  std::size_t lost_ = 0;
+  std::vector<bool> spied_;
+};
+
+/**
+ * GMock for benchmarks, calls don't go through gmock unless they are expected (EXPECT_CALL, ON_CALL)
+ *  - methods returning void or values in registers (integral, enum, pointer, floating point, small trivial classes)
+ *    return zero
+ *  - methods returning other types have to be stubbed (STUB), they return DefaultValue<R>
+ *  - unstubbed methods returning class types in memory (std::string, smart pointers, ...) or long double are undefined
+ *  - calls which don't go through gmock aren't counted as mock calls
+ *  - System V x86-64 ABI (ELF) only
+ */
+template <class T>
+class StubGMock : public GMock<T> {
+#if !defined(__x86_64__) || !defined(__ELF__)
+  static_assert(sizeof(T) == 0, "StubGMock requires System V x86-64 ABI (ELF)");
+#endif
+
+  template <class R, class... TArgs>
+  R stub_call(TArgs...) {
+    return DefaultValue<R>::Get();
+  }
+
+  static const detail::vtable<T> &prototype() {
+    static const auto vt = detail::vtable<T>::shared(reinterpret_cast<void *>(&__gmock_stub_zero),
+                                                     detail::union_cast<void *>(&StubGMock::expected));
+    return vt;
+  }
+
+ public:
+  StubGMock() : GMock<T>{prototype()} {}
+  StubGMock(StubGMock &&) = default;
+  StubGMock(const StubGMock &) = delete;
+
+  template <class R, class B, class... TArgs>
+  void gmock_stub(R (B::*f)(TArgs...)) {
+    this->set_call(detail::offset(f), detail::union_cast<void *>(&StubGMock::template stub_call<R, TArgs...>));
+  }
+
+  template <class R, class B, class... TArgs>
+  void gmock_stub(R (B::*f)(TArgs...) const) {
+    this->set_call(detail::offset(f), detail::union_cast<void *>(&StubGMock::template stub_call<R, TArgs...>));
+  }
+};
+
 template <class T>
 using NaggyGMock = GMock<T>;
 
@@ -454,13 +1230,8 @@ auto object(TMock *mock) {
 }
 }  // testing
 
-#if defined(__clang__)
-#pragma clang optimize on
-#elif defined(__GNUC__)
-#pragma GCC pop_options
-#endif
-
-#define __GMOCK_QNAME(...) decltype(__GUNIT_CAT(#__VA_ARGS__, _gtest_string)) __GUNIT_IGNORE
+#define __GMOCK_QNAME(...) ::testing::detail::fnv1a(#__VA_ARGS__) __GUNIT_IGNORE
+#define __GMOCK_QSTR(...) #__VA_ARGS__ __GUNIT_IGNORE
 #define __GMOCK_FUNCTION(a, b) b __GUNIT_IGNORE
 #define __GMOCK_NAME(...) __GUNIT_CAT(__GMOCK_NAME_, __GUNIT_SIZE(__VA_ARGS__))(__VA_ARGS__)
 #define __GMOCK_NAME_1(a) a __GUNIT_IGNORE
@@ -479,10 +1250,33 @@ auto object(TMock *mock) {
 #define __GMOCK_EXPECT_CALL_0(obj, _, call) GMOCK_EXPECT_CALL_IMPL_(obj, call)
 #define __GMOCK_EXPECT_CALL_1(obj, qcall, call)                                          \
   ((obj).template gmock_call<__GMOCK_QNAME call>(                                        \
+       __GMOCK_QSTR call,                                                                \
        __GUNIT_CAT(__GMOCK_OVERLOAD_CAST_IMPL_, __GMOCK_OVERLOAD_CALL call)(obj, call) & \
        std::decay_t<decltype(obj)>::type::__GMOCK_NAME call __GMOCK_CALL call))          \
       .InternalExpectedAt(__FILE__, __LINE__, #obj, #qcall)
 
+#define SPY(obj, call)                                                     \
+  (obj).template gmock_spy<__GMOCK_SPY_QNAME call>(__GMOCK_SPY_CAST(obj, call) & \
+                                                   std::decay_t<decltype(obj)>::type::__GMOCK_SPY_NAME call)
+#define STUB(obj, call) \
+  (obj).gmock_stub(__GMOCK_SPY_CAST(obj, call) & std::decay_t<decltype(obj)>::type::__GMOCK_SPY_NAME call)
+#define __GMOCK_SPY_QNAME(...) ::testing::detail::fnv1a(#__VA_ARGS__)
+#define __GMOCK_SPY_NAME(...) __GUNIT_CAT(__GMOCK_SPY_NAME_, __GUNIT_SIZE(__VA_ARGS__))(__VA_ARGS__)
+#define __GMOCK_SPY_NAME_1(a) a
+#define __GMOCK_SPY_NAME_2(a, b) a
+#define __GMOCK_SPY_SIZE(...) __GUNIT_SIZE(__VA_ARGS__)
+#define __GMOCK_SPY_FUNCTION(a, b) b
+#define __GMOCK_SPY_CAST(obj, call) __GUNIT_CAT(__GMOCK_SPY_CAST_, __GMOCK_SPY_SIZE call)(obj, call)
+#define __GMOCK_SPY_CAST_1(obj, call)
+#define __GMOCK_SPY_CAST_2(obj, call) \
+  (::testing::detail::function_type_t<std::decay_t<decltype(obj)>::type, __GMOCK_SPY_FUNCTION call>)
+
+#define EXPECT_CALLED(obj, call)                                                         \
+  ((obj).gmock_called(                                                                   \
+       __GUNIT_CAT(__GMOCK_OVERLOAD_CAST_IMPL_, __GMOCK_OVERLOAD_CALL call)(obj, call) & \
+       std::decay_t<decltype(obj)>::type::__GMOCK_NAME call __GMOCK_CALL call))          \
+      .At(__FILE__, __LINE__, #obj, #call)
+
 #define EXPECT_INVOKE(obj, f, ...) __GUNIT_CAT(__GMOCK_EXPECT_INVOKE_IMPL_, __GUNIT_IBP(f))(obj, f, __VA_ARGS__)
 #define __GMOCK_EXPECT_INVOKE_IMPL_0(obj, f, ...)                                                                        \
   ::testing::detail::constexpr_if(::testing::detail::is_valid([](auto &&x) -> decltype(x.f(__VA_ARGS__)) {}),            \
@@ -498,6 +1292,7 @@ auto object(TMock *mock) {
 #define __GMOCK_ON_CALL_0(obj, _, call) GMOCK_ON_CALL_IMPL_(obj, call)
 #define __GMOCK_ON_CALL_1(obj, qcall, call)                                              \
   ((obj).template gmock_call<__GMOCK_QNAME call>(                                        \
+       __GMOCK_QSTR call,                                                                \
        __GUNIT_CAT(__GMOCK_OVERLOAD_CAST_IMPL_, __GMOCK_OVERLOAD_CALL call)(obj, call) & \
        std::decay_t<decltype(obj)>::type::__GMOCK_NAME call __GMOCK_CALL call))          \
       .InternalDefaultActionSetAt(__FILE__, __LINE__, #obj, #qcall)
@@ -7,31 +7,68 @@
 //
 #pragma once
 
+#include <gtest/gtest-spi.h>
 #include <gtest/gtest.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <exception>
+#include <fstream>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "GUnit/Detail/Preprocessor.h"
 #include "GUnit/Detail/TypeTraits.h"
 #include "GUnit/GMake.h"
 #include "GUnit/GMock.h"
 
+#if !defined(GUNIT_SHOULD_FORK)
+#define GUNIT_SHOULD_FORK 0
+#endif
+
+#if !defined(GUNIT_SHOULD_JOBS)
+#define GUNIT_SHOULD_JOBS 1
+#endif
+
 namespace testing {
 inline namespace v1 {
 namespace detail {
 
+/**
+ * Wildcard matching without recursion, on mismatch only the last '*' is retried (no exponential backtracking)
+ */
 inline bool PatternMatchesString(const char* pattern, const char* str) {
-  switch (*pattern) {
-    case '\0':
-    case ':':  // Either ':' or '\0' marks the end of the pattern.
-      return *str == '\0';
-    case '?':  // Matches any single character.
-      return *str != '\0' && PatternMatchesString(pattern + 1, str + 1);
-    case '*':  // Matches any string (possibly empty) of characters.
-      return (*str != '\0' && PatternMatchesString(pattern, str + 1)) || PatternMatchesString(pattern + 1, str);
-    default:  // Non-special character.  Matches itself.
-      return *pattern == *str && PatternMatchesString(pattern + 1, str + 1);
+  const auto end = [](char c) { return c == '\0' || c == ':'; };  // Either ':' or '\0' marks the end of the pattern.
+  const char* star = nullptr;
+  const char* star_str = nullptr;
+  while (*str != '\0') {
+    if (*pattern == '*') {  // Matches any string (possibly empty) of characters.
+      star = ++pattern;
+      star_str = str;
+    } else if (!end(*pattern) && (*pattern == '?' || *pattern == *str)) {  // '?' matches any single character.
+      ++pattern;
+      ++str;
+    } else if (star) {  // Let the last '*' match one more character.
+      pattern = star;
+      str = ++star_str;
+    } else {
+      return false;
+    }
   }
+  while (*pattern == '*') {
+    ++pattern;
+  }
+  return end(*pattern);
 }
 
 inline bool MatchesFilter(const std::string& name, const char* filter) {
@@ -54,32 +91,593 @@ inline bool MatchesFilter(const std::string& name, const char* filter) {
   }
 }
 
-inline bool FilterMatchesShould(const std::string& name, const std::string& should) {
-  // Split --gtest_filter at '-', if there is one, to separate into
-  // positive filter and negative filter portions
-  const char* const p = should.c_str();
-  const char* const dash = strchr(p, '-');
-  std::string positive;
-  std::string negative;
-  if (dash == nullptr) {
-    positive = should.c_str();  // Whole string is a positive filter
-    negative = "";
-  } else {
-    positive = std::string(p, dash);   // Everything up to the dash
-    negative = std::string(dash + 1);  // Everything after the dash
-    if (positive.empty()) {
+/**
+ * SHOULD filter (`positive[-negative]` patterns) parsed once per process
+ */
+class ShouldFilter {
+ public:
+  explicit ShouldFilter(const std::string& filter) : filter(filter) {
+    // Split --gtest_filter at '-', if there is one, to separate into
+    // positive filter and negative filter portions
+    const auto dash = filter.find('-');
+    if (dash == std::string::npos) {
+      Split(filter, positive);  // Whole string is a positive filter
+      Split("", negative);
+    } else {
       // Treat '-test1' as the same as '*-test1'
-      positive = "*";
+      Split(dash ? filter.substr(0, dash) : "*", positive);
+      Split(filter.substr(dash + 1), negative);
     }
   }
 
-  return MatchesFilter(name, positive.c_str()) && !MatchesFilter(name, negative.c_str());
+  static const ShouldFilter& Get(const std::string& filter) {
+    static ShouldFilter cached{filter};
+    if (cached.filter != filter) {
+      cached = ShouldFilter{filter};
+    }
+    return cached;
+  }
+
+  bool Matches(const char* name) const { return MatchesAny(name, positive) && !MatchesAny(name, negative); }
+
+ private:
+  static void Split(const std::string& filter, std::vector<std::string>& patterns) {
+    for (std::size_t begin = 0;;) {
+      const auto sep = filter.find(':', begin);
+      patterns.push_back(filter.substr(begin, sep - begin));
+      if (sep == std::string::npos) {
+        break;
+      }
+      begin = sep + 1;
+    }
+  }
+
+  static bool MatchesAny(const char* name, const std::vector<std::string>& patterns) {
+    return std::any_of(patterns.begin(), patterns.end(),
+                       [name](const auto& pattern) { return PatternMatchesString(pattern.c_str(), name); });
+  }
+
+  std::string filter;
+  std::vector<std::string> positive;
+  std::vector<std::string> negative;
+};
+
+inline bool FilterMatchesShould(const std::string& name, const std::string& should) {
+  return ShouldFilter::Get(should).Matches(name.c_str());
 }
 
+struct ShouldInfo {
+  const char* name;
+  int line;
+  bool disabled;
+  std::size_t index;  // in order of registration of all SHOULDs
+};
+
+/**
+ * Shard of SHOULDs (GTEST_TOTAL_SHARDS/GTEST_SHARD_INDEX), each SHOULD belongs to the shard of its registration index
+ */
+struct ShouldShard {
+  std::size_t total = 1;
+  std::size_t index = 0;
+
+  static const ShouldShard& Get() {
+    static const auto shard = [] {
+      const auto total = std::getenv("GTEST_TOTAL_SHARDS");
+      const auto index = std::getenv("GTEST_SHARD_INDEX");
+      if (!total || !index || !GTEST_FLAG(internal_run_death_test).empty()) {  // as gtest, death tests aren't sharded
+        return ShouldShard{};
+      }
+      const auto shards = std::strtoul(total, nullptr, 10);
+      return shards > 1 ? ShouldShard{shards, std::strtoul(index, nullptr, 10)} : ShouldShard{};
+    }();
+    return shard;
+  }
+
+  bool Contains(std::size_t should) const { return total <= 1 || should == std::size_t(-1) || should % total == index; }
+};
+
+template <class TTag, class T, T Ptr>
+struct MemberAccess {
+  friend T Member(TTag) { return Ptr; }
+};
+
+struct TestInfoShouldRun {};
+struct TestInfoMatchesFilter {};
+struct TestInfoIsDisabled {};
+struct TestCaseShouldRun {};
+bool TestInfo::*Member(TestInfoShouldRun);
+bool TestInfo::*Member(TestInfoMatchesFilter);
+bool TestInfo::*Member(TestInfoIsDisabled);
+bool TestCase::*Member(TestCaseShouldRun);
+template struct MemberAccess<TestInfoShouldRun, bool TestInfo::*, &TestInfo::should_run_>;
+template struct MemberAccess<TestInfoMatchesFilter, bool TestInfo::*, &TestInfo::matches_filter_>;
+template struct MemberAccess<TestInfoIsDisabled, bool TestInfo::*, &TestInfo::is_disabled_>;
+template struct MemberAccess<TestCaseShouldRun, bool TestCase::*, &TestCase::should_run_>;
+
+/**
+ * SHOULDs of all GTESTs, registered at static initialization by SHOULD/DISABLED_SHOULD
+ * Listed after the tests with --gtest_list_tests when GUNIT_SHOULD_LIST is set (gtest doesn't notify listeners when listing)
+ */
+class ShouldManifest {
+ public:
+  struct Test {
+    std::string suite;
+    std::string name;
+    const char* file;
+    int line;
+    std::vector<ShouldInfo> shoulds;  // sorted by line
+    bool runtime_shoulds = false;     // SHOULDs named at run time aren't registered
+  };
+
+  static ShouldManifest& Instance() {
+    static ShouldManifest manifest;
+    static const auto listed = std::atexit([] {  // registered after construction, called before destruction
+      if (GTEST_FLAG(list_tests) && std::getenv("GUNIT_SHOULD_LIST")) {
+        Instance().List(std::cout);
+        std::cout.flush();
+      }
+    });
+    (void)listed;
+    return manifest;
+  }
+
+  ShouldManifest(const ShouldManifest&) = delete;
+  ShouldManifest& operator=(const ShouldManifest&) = delete;
+
+  void AddTest(const char* file, int line, const std::string& suite, const std::string& name) {
+    auto& test = Get(file, line);
+    test.suite = suite;
+    test.name = name;
+  }
+
+  std::size_t AddShould(const char* file, int line, const char* name, int should_line, bool disabled) {
+    auto& shoulds = Get(file, line).shoulds;
+    const auto it = std::upper_bound(shoulds.begin(), shoulds.end(), should_line,
+                                     [](int line, const ShouldInfo& should) { return line < should.line; });
+    shoulds.insert(it, ShouldInfo{name, should_line, disabled, size});
+    return size++;
+  }
+
+  std::size_t AddRuntimeShould(const char* file, int line) {
+    Get(file, line).runtime_shoulds = true;
+    return std::size_t(-1);
+  }
+
+  const std::vector<Test>& Tests() const { return tests; }
+
+  const Test* Find(const char* file, int line) const {
+    const auto it = index.find(Key(file, line));
+    return it == index.end() ? nullptr : &tests[it->second];
+  }
+
+  /**
+   * Lists SHOULDs of the tests matching --gtest_filter in the given shard as gtest lists tests
+   * `Suite.` followed by `  Name:should  # file:line` lines, each of which is a --gtest_filter pattern
+   */
+  void List(std::ostream& out, const ShouldShard& shard = ShouldShard::Get(), bool matching_only = true) const {
+    const auto& unit_test = *UnitTest::GetInstance();
+    for (auto i = 0; i < unit_test.total_test_case_count(); ++i) {
+      const auto& test_case = *unit_test.GetTestCase(i);
+      auto listed = false;
+      for (auto j = 0; j < test_case.total_test_count(); ++j) {
+        const auto& info = *test_case.GetTestInfo(j);
+        const auto* test = Find(info.file(), info.line());
+        if (!test || (matching_only && !(info.*Member(TestInfoMatchesFilter{})))) {
+          continue;
+        }
+        for (const auto& should : test->shoulds) {
+          if (!shard.Contains(should.index)) {
+            continue;
+          }
+          if (!listed) {
+            out << test_case.name() << ".\n";
+            listed = true;
+          }
+          out << "  " << info.name() << ':' << should.name << (should.disabled ? "  # DISABLED " : "  # ") << test->file << ':'
+              << should.line << '\n';
+        }
+      }
+    }
+  }
+
+ private:
+  ShouldManifest() = default;
+
+  static std::string Key(const char* file, int line) { return std::string{file} + ':' + std::to_string(line); }
+
+  Test& Get(const char* file, int line) {
+    const auto it = index.emplace(Key(file, line), tests.size());
+    if (it.second) {
+      tests.push_back(Test{{}, {}, file, line, {}, false});
+    }
+    return tests[it.first->second];
+  }
+
+  std::vector<Test> tests;
+  std::unordered_map<std::string, std::size_t> index;
+  std::size_t size = 0;
+};
+
+/**
+ * Selects GTESTs with registered SHOULDs by their SHOULDs instead of gtest's sharding of tests,
+ * so that each GTEST runs in every shard owning one of its SHOULDs (TestRun runs just these)
+ */
+class ShouldSharding : public EmptyTestEventListener {
+ public:
+  static void Append() {
+    static const auto appended = [] {
+      UnitTest::GetInstance()->listeners().Append(new ShouldSharding{});  // takes ownership
+      return true;
+    }();
+    (void)appended;
+  }
+
+  void OnTestProgramStart(const UnitTest& unit_test) override {
+    const auto& shard = ShouldShard::Get();
+    if (shard.total <= 1) {
+      return;
+    }
+    for (auto i = 0; i < unit_test.total_test_case_count(); ++i) {
+      auto& test_case = const_cast<TestCase&>(*unit_test.GetTestCase(i));
+      auto selected = false;
+      for (auto j = 0; j < test_case.total_test_count(); ++j) {
+        auto& info = const_cast<TestInfo&>(*test_case.GetTestInfo(j));
+        const auto* test = ShouldManifest::Instance().Find(info.file(), info.line());
+        if (test && !test->runtime_shoulds && !test->shoulds.empty()) {
+          info.*Member(TestInfoShouldRun{}) = Runnable(info) && HasShould(*test, shard);
+        }
+        selected |= info.should_run();
+      }
+      test_case.*Member(TestCaseShouldRun{}) = selected;
+    }
+  }
+
+ private:
+  ShouldSharding() = default;
+
+  static bool Runnable(const TestInfo& info) {
+    return info.*Member(TestInfoMatchesFilter{}) && (GTEST_FLAG(also_run_disabled_tests) || !(info.*Member(TestInfoIsDisabled{})));
+  }
+
+  static bool HasShould(const ShouldManifest::Test& test, const ShouldShard& shard) {
+    return std::any_of(test.shoulds.begin(), test.shoulds.end(), [&shard](const auto& should) {
+      return (!should.disabled || GTEST_FLAG(also_run_disabled_tests)) && shard.Contains(should.index);
+    });
+  }
+};
+
+template <class TTest, class TName, int Line, bool Disabled>
+struct should_registrar {
+  static const std::size_t index;
+};
+
+template <class TTest, class TName, int Line, bool Disabled>
+const std::size_t should_registrar<TTest, TName, Line, Disabled>::index =
+    ShouldManifest::Instance().AddShould(TTest::TEST_FILE, TTest::TEST_LINE, TName::c_str(), Line, Disabled);
+
+template <class TTest, int Line, bool Disabled>
+struct should_registrar<TTest, void, Line, Disabled> {
+  static const std::size_t index;
+};
+
+template <class TTest, int Line, bool Disabled>
+const std::size_t should_registrar<TTest, void, Line, Disabled>::index =
+    ShouldManifest::Instance().AddRuntimeShould(TTest::TEST_FILE, TTest::TEST_LINE);
+
+/**
+ * Whether the spelling of a SHOULD name (#NAME) is a plain string literal, otherwise the name is known at run time only
+ */
+constexpr bool is_string_literal(const char* str) {
+  if (*str++ != '"') {
+    return false;
+  }
+  while (*str && *str != '"' && *str != '\\') {
+    ++str;
+  }
+  return *str == '"' && !str[1];
+}
+
+/**
+ * Statistics of a single SHOULD section (times in milliseconds, cpu time of the whole process)
+ */
+struct ShouldStats {
+  double wall_time = 0;
+  double cpu_time = 0;
+  std::size_t mock_calls = 0;
+};
+
+struct ShouldResult {
+  std::string test;
+  std::string name;
+  bool failed = false;
+  ShouldStats stats;
+};
+
+inline std::string FormatShouldStats(const ShouldStats& stats) {
+  char buffer[128];
+  std::snprintf(buffer, sizeof(buffer), "%.3f ms, cpu %.3f ms, %zu mock calls", stats.wall_time, stats.cpu_time,
+                stats.mock_calls);
+  return buffer;
+}
+
+class ShouldReporter {
+ public:
+  virtual ~ShouldReporter() = default;
+  virtual void OnShouldStart(const char* name) = 0;
+  virtual void OnShouldEnd(const ShouldResult& result) = 0;
+};
+
+/**
+ * Prints SHOULDs and, with --gtest_print_time, their timings (not flushed per SHOULD)
+ */
+class ConsoleShouldReporter : public ShouldReporter {
+ public:
+  void OnShouldStart(const char* name) override { std::cout << "[ SHOULD   ] " << name << '\n'; }
+
+  void OnShouldEnd(const ShouldResult& result) override {
+    if (GTEST_FLAG(print_time)) {
+      std::cout << "[     TIME ] " << result.name << " (" << FormatShouldStats(result.stats) << ")\n";
+    }
+  }
+};
+
+/**
+ * Records SHOULDs as properties of the current test (--gtest_output=xml|json)
+ */
+class PropertyShouldReporter : public ShouldReporter {
+ public:
+  void OnShouldStart(const char*) override {}
+
+  void OnShouldEnd(const ShouldResult& result) override {
+    if (GTEST_FLAG(output).empty()) {
+      return;
+    }
+    Test::RecordProperty(Key(result.name), FormatShouldStats(result.stats) + (result.failed ? ", failed" : ""));
+  }
+
+  /**
+   * `should_<name>_<hash>`, non-alphanumeric characters of the name are replaced by '_', hence the hash of the name (fnv1a)
+   */
+  static std::string Key(const std::string& name) {
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(fnv1a(name.c_str())));
+    auto key = "should_" + name + '_' + hash;
+    std::replace_if(key.begin(), key.end(), [](char c) { return !std::isalnum(static_cast<unsigned char>(c)); }, '_');
+    return key;
+  }
+};
+
+/**
+ * Writes all SHOULDs to a json file at exit (GUNIT_SHOULD_OUTPUT environment variable)
+ */
+class JsonShouldReporter : public ShouldReporter {
+ public:
+  explicit JsonShouldReporter(const std::string& file) : file(file) {}
+
+  ~JsonShouldReporter() override {
+    std::ofstream out{file};
+    out << "{\n  \"shoulds\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      const auto& result = results[i];
+      out << (i ? ",\n" : "\n") << "    {\"test\": " << Quote(result.test) << ", \"should\": " << Quote(result.name)
+          << ", \"failed\": " << (result.failed ? "true" : "false") << ", \"wall_time_ms\": " << result.stats.wall_time
+          << ", \"cpu_time_ms\": " << result.stats.cpu_time << ", \"mock_calls\": " << result.stats.mock_calls << "}";
+    }
+    out << "\n  ]\n}\n";
+  }
+
+  void OnShouldStart(const char*) override {}
+  void OnShouldEnd(const ShouldResult& result) override { results.push_back(result); }
+
+ private:
+  static std::string Quote(const std::string& str) {
+    std::string quoted = "\"";
+    for (const auto c : str) {
+      if (c == '"' || c == '\\') {
+        quoted += '\\';
+        quoted += c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        char buffer[8];
+        std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+        quoted += buffer;
+      } else {
+        quoted += c;
+      }
+    }
+    return quoted + '"';
+  }
+
+  std::string file;
+  std::vector<ShouldResult> results;
+};
+
+/**
+ * Reporters of all SHOULDs in the process, console and properties (and json with GUNIT_SHOULD_OUTPUT) by default
+ */
+class ShouldReporters : public ShouldReporter {
+ public:
+  static ShouldReporters& Instance() {
+    static ShouldReporters reporters;
+    return reporters;
+  }
+
+  void Append(std::unique_ptr<ShouldReporter> reporter) { reporters.push_back(std::move(reporter)); }
+  void Clear() { reporters.clear(); }
+
+  void OnShouldStart(const char* name) override {
+    for (const auto& reporter : reporters) {
+      reporter->OnShouldStart(name);
+    }
+  }
+
+  void OnShouldEnd(const ShouldResult& result) override {
+    for (const auto& reporter : reporters) {
+      reporter->OnShouldEnd(result);
+    }
+  }
+
+ private:
+  ShouldReporters() {
+    Append(std::make_unique<ConsoleShouldReporter>());
+    Append(std::make_unique<PropertyShouldReporter>());
+    if (const auto file = std::getenv("GUNIT_SHOULD_OUTPUT")) {
+      Append(std::make_unique<JsonShouldReporter>(file));
+    }
+  }
+
+  std::vector<std::unique_ptr<ShouldReporter>> reporters;
+};
+
+/**
+ * Statistics and test part results of a forked SHOULD, sent to the parent through a pipe
+ */
+class TestPartResultPipe {
+ public:
+  static void Write(int fd, const ShouldStats& stats, const TestPartResultArray& results) {
+    WriteAll(fd, &stats, sizeof(stats));
+    for (auto i = 0; i < results.size(); ++i) {
+      const auto& result = results.GetTestPartResult(i);
+      WriteInt(fd, result.type());
+      WriteInt(fd, result.line_number());
+      WriteString(fd, result.file_name() ? result.file_name() : "");
+      WriteString(fd, result.message());
+    }
+  }
+
+  /**
+   * Appends available data, returns false at the end of the stream
+   */
+  static bool Read(int fd, std::string& data) {
+    char buffer[4096];
+    for (;;) {
+      const auto size = read(fd, buffer, sizeof(buffer));
+      if (size > 0) {
+        data.append(buffer, size);
+        return true;
+      }
+      if (size == 0 || errno != EINTR) {
+        return false;
+      }
+    }
+  }
+
+  static ShouldStats Replay(const std::string& data) {
+    ShouldStats stats;
+    if (data.size() < sizeof(stats)) {
+      return stats;
+    }
+    std::memcpy(&stats, data.data(), sizeof(stats));
+    std::size_t pos = sizeof(stats);
+    int type = 0, line = 0;
+    std::string file, message;
+    while (ReadInt(data, pos, type) && ReadInt(data, pos, line) && ReadString(data, pos, file) && ReadString(data, pos, message)) {
+      internal::AssertHelper(static_cast<TestPartResult::Type>(type), file.empty() ? nullptr : file.c_str(), line,
+                             message.c_str()) = Message();
+    }
+    return stats;
+  }
+
+ private:
+  static void WriteAll(int fd, const void* data, std::size_t size) {
+    auto ptr = static_cast<const char*>(data);
+    while (size) {
+      const auto written = write(fd, ptr, size);
+      if (written < 0 && errno == EINTR) {
+        continue;
+      }
+      if (written <= 0) {
+        return;
+      }
+      ptr += written;
+      size -= written;
+    }
+  }
+
+  static void WriteInt(int fd, int value) { WriteAll(fd, &value, sizeof(value)); }
+
+  static void WriteString(int fd, const std::string& str) {
+    WriteInt(fd, str.size());
+    WriteAll(fd, str.data(), str.size());
+  }
+
+  static bool ReadInt(const std::string& data, std::size_t& pos, int& value) {
+    if (data.size() - pos < sizeof(value)) {
+      return false;
+    }
+    std::memcpy(&value, data.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+  }
+
+  static bool ReadString(const std::string& data, std::size_t& pos, std::string& str) {
+    int size = 0;
+    if (!ReadInt(data, pos, size) || size < 0 || data.size() - pos < std::size_t(size)) {
+      return false;
+    }
+    str.assign(data, pos, size);
+    pos += size;
+    return true;
+  }
+};
+
 struct TestRun {
   std::string should = GetShouldParam();
   bool once = true;
 
+  /**
+   * Runs the test prefix once and forks at each SHOULD, the child runs just this SHOULD from a copy-on-write snapshot
+   * and reports its results back to the parent (GUNIT_SHOULD_FORK)
+   */
+  bool fork = GUNIT_SHOULD_FORK;
+
+  /**
+   * Number of processes running forked SHOULDs at once (parent included), more than one implies `fork`
+   * (GUNIT_SHOULD_JOBS environment variable or GUNIT_SHOULD_JOBS, 0 - number of cores)
+   */
+  std::size_t jobs = GetJobsParam();
+
+  ShouldReporter* reporter = &ShouldReporters::Instance();
+
+  /**
+   * Shard of SHOULDs run by this process, applies to tests without SHOULDs named at run time
+   */
+  ShouldShard shard = ShouldShard::Get();
+
+  static constexpr auto UNKNOWN_INDEX = std::size_t(-1);
+
+  /**
+   * Scope of an executed SHOULD (its body), ends the SHOULD when destroyed
+   */
+  class Section {
+   public:
+    explicit Section(TestRun* run = nullptr) : run(run) {}
+    Section(Section&& other) noexcept : run(other.run) { other.run = nullptr; }
+    ~Section() {
+      if (run) {
+        run->End();
+      }
+    }
+
+    explicit operator bool() const { return run; }
+
+   private:
+    TestRun* run = nullptr;
+  };
+
+  explicit TestRun(const ShouldManifest::Test* manifest = nullptr) : manifest(manifest) {}
+  TestRun(const TestRun&) = delete;
+  TestRun& operator=(const TestRun&) = delete;
+
+  ~TestRun() {
+    if (child_fd != -1) {
+      Exit();
+    }
+    Wait(0);
+    while (!shareds.empty()) {
+      shareds.pop_back();
+    }
+  }
+
   std::string GetShouldParam() const {
     const auto sep = GTEST_FLAG(filter).find(":");
     return sep == std::string::npos
@@ -87,26 +685,254 @@ struct TestRun {
       : GTEST_FLAG(filter).substr(sep + 1);
   }
 
-  bool run(bool disabled, const std::string& name, int line) {
-    if (once) {
-      return false;
+  static std::size_t GetEnv(const char* name, std::size_t value) {
+    const auto env = std::getenv(name);
+    return env ? std::strtoul(env, nullptr, 10) : value;
+  }
+
+  static std::size_t GetJobsParam() {
+    const auto jobs = GetEnv("GUNIT_SHOULD_JOBS", GUNIT_SHOULD_JOBS);
+    return jobs ? jobs : std::max(sysconf(_SC_NPROCESSORS_ONLN), 1l);
+  }
+
+  /**
+   * Whether the test body has to be run (again), each pass runs the next SHOULD
+   * Passes end after the last SHOULD selected from the manifest, otherwise after a pass which didn't run any SHOULD
+   */
+  bool next() {
+    const auto next = once && (!passes || HasPending());
+    once = false;
+    ++passes;
+    return next;
+  }
+
+  /**
+   * Object shared by all passes of the test body (GTEST_SHARED), made on first use and destroyed with the TestRun
+   */
+  template <class TMake>
+  auto& shared(const TMake& make) {
+    using T = std::decay_t<decltype(make())>;
+    const auto id = type_id<TMake>();
+    const auto it = std::find_if(shareds.begin(), shareds.end(), [id](const auto& shared) { return shared.first == id; });
+    if (it != shareds.end()) {
+      return *static_cast<T*>(it->second.get());
+    }
+    auto object = std::make_shared<T>(make());
+    shareds.emplace_back(id, object);
+    return *object;
+  }
+
+  Section run(bool disabled, const std::string& name, int line, std::size_t index = UNKNOWN_INDEX) {
+    return run(disabled, name.c_str(), line, index);
+  }
+
+  Section run(bool disabled, const char* name, int line, std::size_t index = UNKNOWN_INDEX) {
+    if (once || child_fd != -1) {
+      return Section{};
     }
 
     if (disabled && !GTEST_FLAG(also_run_disabled_tests)) {
-      std::cout << "[ DISABLED ] " << name << std::endl;
-      return false;
+      std::cout << "[ DISABLED ] " << name << '\n';
+      return Section{};
     }
 
-    const auto result = line > test_line && FilterMatchesShould(name, should);
-    if (result) {
-      std::cout << "[ SHOULD   ] " << name << std::endl;
-      test_line = line;
-      once = true;
+    if (line <= test_line || !Selected(name, index)) {
+      return Section{};
     }
-    return result;
+
+    reporter->OnShouldStart(name);
+    test_line = line;
+    if ((fork || jobs > 1) && !Fork(name)) {
+      return Section{};
+    }
+    once = child_fd == -1;
+    Start(name);
+    return Section{this};
   }
 
   int test_line = 0;
+  std::size_t passes = 0;
+
+ private:
+  bool Selected(const char* name, std::size_t index) const {
+    return ShouldFilter::Get(should).Matches(name) && (!manifest || manifest->runtime_shoulds || shard.Contains(index));
+  }
+
+  bool HasPending() const {
+    if (!manifest || manifest->runtime_shoulds) {
+      return true;
+    }
+    return std::any_of(manifest->shoulds.begin(), manifest->shoulds.end(), [this](const auto& should) {
+      return should.line > test_line && (!should.disabled || GTEST_FLAG(also_run_disabled_tests)) &&
+             Selected(should.name, should.index);
+    });
+  }
+
+  static std::string TestName() {
+    const auto* info = UnitTest::GetInstance()->current_test_info();
+    return info ? std::string{info->test_case_name()} + "." + info->name() : std::string{};
+  }
+
+  static int TestParts() {
+    const auto* info = UnitTest::GetInstance()->current_test_info();
+    return info ? info->result()->total_part_count() : 0;
+  }
+
+  static bool FailedSince(int parts) {
+    const auto* info = UnitTest::GetInstance()->current_test_info();
+    for (auto i = parts; info && i < info->result()->total_part_count(); ++i) {
+      if (info->result()->GetTestPartResult(i).failed()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static double CpuTime() {
+    timespec time{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec * 1e3 + time.tv_nsec / 1e6;
+  }
+
+  void Start(const char* name) {
+    current = name;
+    start_parts = TestParts();
+    start_calls = mock_calls::total();
+    start_cpu_time = CpuTime();
+    start_time = std::chrono::steady_clock::now();
+  }
+
+  void End() {
+    stats.wall_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    stats.cpu_time = CpuTime() - start_cpu_time;
+    stats.mock_calls = mock_calls::total() - start_calls;
+    if (child_fd == -1) {
+      reporter->OnShouldEnd(ShouldResult{TestName(), current, FailedSince(start_parts), stats});
+    }
+  }
+
+  struct Child {
+    pid_t pid;
+    int fd;
+    std::string name;
+    std::string data;
+    int status;
+  };
+
+  /**
+   * Returns true in the child or if SHOULD has to be run without forking
+   */
+  bool Fork(const char* name) {
+    int fds[2] = {};
+    if (pipe(fds)) {
+      return true;  // re-run the prefix instead
+    }
+
+    std::cout.flush();
+    std::fflush(nullptr);
+    const auto pid = ::fork();
+    if (pid == -1) {
+      close(fds[0]);
+      close(fds[1]);
+      return true;  // re-run the prefix instead
+    }
+
+    if (!pid) {
+      close(fds[0]);
+      for (const auto& child : children) {
+        if (child.fd != -1) {
+          close(child.fd);
+        }
+      }
+      children.clear();
+      child_fd = fds[1];
+      results = std::make_unique<TestPartResultArray>();
+      reporters[0] = std::make_unique<ScopedFakeTestPartResultReporter>(ScopedFakeTestPartResultReporter::INTERCEPT_ALL_THREADS,
+                                                                        results.get());
+      reporters[1] = std::make_unique<ScopedFakeTestPartResultReporter>(
+          ScopedFakeTestPartResultReporter::INTERCEPT_ONLY_CURRENT_THREAD, results.get());
+      return true;
+    }
+
+    close(fds[1]);
+    children.push_back(Child{pid, fds[0], name, {}, 0});
+    ++running;
+    Wait(jobs - 1);
+    return false;
+  }
+
+  /**
+   * Collects results of children until at most `max` of them are still running
+   * Results are reported in order of SHOULDs, whichever child finishes first
+   */
+  void Wait(std::size_t max) {
+    while (running > max) {
+      std::vector<pollfd> fds;
+      for (const auto& child : children) {
+        if (child.fd != -1) {
+          fds.push_back(pollfd{child.fd, POLLIN, 0});
+        }
+      }
+      if (poll(fds.data(), fds.size(), -1) == -1) {
+        continue;
+      }
+      for (auto& child : children) {
+        const auto it = std::find_if(fds.begin(), fds.end(), [&](const auto& fd) { return fd.fd == child.fd; });
+        if (child.fd == -1 || it == fds.end() || !it->revents || TestPartResultPipe::Read(child.fd, child.data)) {
+          continue;
+        }
+        close(child.fd);
+        child.fd = -1;
+        while (waitpid(child.pid, &child.status, 0) == -1 && errno == EINTR) {
+        }
+        --running;
+      }
+    }
+
+    while (!children.empty() && children.front().fd == -1) {
+      Report(children.front());
+      children.pop_front();
+    }
+  }
+
+  void Report(const Child& child) {
+    const auto parts = TestParts();
+    const auto stats = TestPartResultPipe::Replay(child.data);
+    const auto crashed = WIFSIGNALED(child.status) || (WIFEXITED(child.status) && WEXITSTATUS(child.status));
+    if (WIFSIGNALED(child.status)) {
+      ADD_FAILURE() << "SHOULD \"" << child.name << "\" was terminated by signal " << WTERMSIG(child.status);
+    } else if (WIFEXITED(child.status) && WEXITSTATUS(child.status)) {
+      ADD_FAILURE() << "SHOULD \"" << child.name << "\" exited with code " << WEXITSTATUS(child.status);
+    }
+    reporter->OnShouldEnd(ShouldResult{TestName(), child.name, crashed || FailedSince(parts), stats});
+  }
+
+  void Exit() {
+    if (std::uncaught_exception()) {
+      ADD_FAILURE() << "Uncaught exception in SHOULD";
+    }
+    reporters[1].reset();
+    reporters[0].reset();
+    TestPartResultPipe::Write(child_fd, stats, *results);
+    close(child_fd);
+    std::cout.flush();
+    std::fflush(nullptr);
+    _exit(0);
+  }
+
+  int child_fd = -1;
+  std::unique_ptr<TestPartResultArray> results;
+  std::unique_ptr<ScopedFakeTestPartResultReporter> reporters[2];
+  std::deque<Child> children;
+  std::size_t running = 0;
+  std::string current;
+  int start_parts = 0;
+  std::size_t start_calls = 0;
+  double start_cpu_time = 0;
+  std::chrono::steady_clock::time_point start_time;
+  ShouldStats stats;
+  const ShouldManifest::Test* manifest = nullptr;
+  std::vector<std::pair<std::size_t, std::shared_ptr<void>>> shareds;
 };
 
 template <bool DISABLED, class T>
@@ -144,12 +970,20 @@ class GTestAutoRegister {
 
  public:
   GTestAutoRegister() {
+    ShouldSharding::Append();
+    ShouldManifest::Instance().AddTest(T::TEST_FILE, T::TEST_LINE,
+                                       IsDisabled(DISABLED) + std::string{GetTypeName(detail::type<typename T::TEST_TYPE>{})},
+                                       T::TEST_NAME::c_str());
     MakeAndRegisterTestInfo(DISABLED, GetTypeName(detail::type<typename T::TEST_TYPE>{}), T::TEST_NAME::c_str(), T::TEST_FILE,
                             T::TEST_LINE, detail::type<decltype(internal::MakeAndRegisterTestInfo)>{});
   }
 
   template <class TEval, class TGenerateNames>
   GTestAutoRegister(const TEval& eval, const TGenerateNames& genNames) {
+    ShouldSharding::Append();
+    const std::string type = GetTypeName(detail::type<typename T::TEST_TYPE>{});
+    ShouldManifest::Instance().AddTest(T::TEST_FILE, T::TEST_LINE, IsDisabled(DISABLED) + std::string{T::TEST_NAME::c_str()} + "/" + type,
+                                       type + "/*");
     UnitTest::GetInstance()
         ->parameterized_test_registry()
         .GetTestCasePatternHolder<T>(GetTypeName(detail::type<typename T::TEST_TYPE>{}), {T::TEST_FILE, T::TEST_LINE})
@@ -164,15 +998,62 @@ class GTestAutoRegister {
   }
 };
 
+/**
+ * SUT of GTest, made together with mocks on first access of any of them, unless they are assigned before
+ */
+template <class T>
+class lazy_sut {
+ public:
+  explicit lazy_sut(mocks_t& mocks) : mocks(mocks) {}
+  lazy_sut(const lazy_sut&) = delete;
+
+  lazy_sut& operator=(std::unique_ptr<T>&& sut) {
+    mocks.cancel_deferred();
+    this->sut = std::move(sut);
+    return *this;
+  }
+
+  operator std::unique_ptr<T>&() & { return get_sut(); }
+  operator const std::unique_ptr<T>&() const& { return get_sut(); }
+  operator std::unique_ptr<T>&&() && { return std::move(get_sut()); }
+
+  T* operator->() const { return get_sut().get(); }
+  T& operator*() const { return *get_sut(); }
+  T* get() const { return get_sut().get(); }
+  explicit operator bool() const { return bool(get_sut()); }
+
+  void reset(T* sut = nullptr) {
+    mocks.cancel_deferred();
+    this->sut.reset(sut);
+  }
+
+  T* release() { return get_sut().release(); }
+
+  friend bool operator==(const lazy_sut& sut, std::nullptr_t) { return !sut; }
+  friend bool operator==(std::nullptr_t, const lazy_sut& sut) { return !sut; }
+  friend bool operator!=(const lazy_sut& sut, std::nullptr_t) { return bool(sut); }
+  friend bool operator!=(std::nullptr_t, const lazy_sut& sut) { return bool(sut); }
+
+ private:
+  std::unique_ptr<T>& get_sut() const {
+    mocks.make_deferred();
+    return sut;
+  }
+
+  mocks_t& mocks;
+  mutable std::unique_ptr<T> sut;
+};
+
 template <class T, class TParamType, class = detail::is_complete<T>, class = detail::is_complete_base_of<Test, T>>
 class GTest : public std::conditional_t<std::is_same<TParamType, void>::value, Test, TestWithParam<TParamType>> {
-  explicit GTest(std::false_type) {}
-  explicit GTest(std::true_type) { std::tie(sut, mocks) = make<SUT, StrictGMock>(); }
+  static void make_default(void* self) { static_cast<GTest*>(self)->make_default(is_creatable<T>{}); }
+  void make_default(std::true_type) { std::tie(sut, mocks) = testing::make<SUT, StrictGMock>(); }
+  void make_default(std::false_type) {}
 
  public:
   using SUT = std::unique_ptr<T>;
 
-  GTest() : GTest(is_creatable<T>{}) {}
+  GTest() { mocks.defer(&GTest::make_default, this); }
 
   template <class TMock>
   decltype(auto) mock() {
@@ -180,7 +1061,7 @@ class GTest : public std::conditional_t<std::is_same<TParamType, void>::value, T
   }
 
   mocks_t mocks;
-  SUT sut;  // has to be after mocks
+  lazy_sut<T> sut{mocks};  // has to be after mocks
 };
 
 template <class T, class TParamType, class TAny>
@@ -225,9 +1106,8 @@ class GTest : public detail::GTest<T, TParamType> {};
     static constexpr auto TEST_LINE = __LINE__;                                                                           \
     void TestBodyImpl(::testing::detail::TestRun&);                                                                       \
     void TestBody() {                                                                                                     \
-      ::testing::detail::TestRun tr;                                                                                      \
-      while (tr.once) {                                                                                                   \
-        tr.once = false;                                                                                                  \
+      ::testing::detail::TestRun tr{::testing::detail::ShouldManifest::Instance().Find(TEST_FILE, TEST_LINE)};            \
+      while (tr.next()) {                                                                                                 \
         GTEST test;                                                                                                       \
         test.SetUp();                                                                                                     \
         test.TestBodyImpl(tr);                                                                                            \
@@ -262,5 +1142,19 @@ class GTest : public detail::GTest<T, TParamType> {};
 #define GTEST(...) __GUNIT_CAT(__GTEST_IMPL_, __GUNIT_SIZE(__VA_ARGS__))(false, __VA_ARGS__)
 #define DISABLED_GTEST(...) __GUNIT_CAT(__GTEST_IMPL_, __GUNIT_SIZE(__VA_ARGS__))(true, __VA_ARGS__)
 
-#define SHOULD(NAME) if (tr_gtest.run(false, NAME, __LINE__))
-#define DISABLED_SHOULD(NAME) if (tr_gtest.run(true, NAME, __LINE__))
+#define __SHOULD_IMPL(DISABLED, NAME)                                                                                     \
+  if (const auto should_gtest = tr_gtest.run(                                                                             \
+          DISABLED, NAME, __LINE__, [](const auto* test) {                                                                \
+            struct should_string {                                                                                        \
+              const char* chrs = #NAME + 1;                                                                               \
+            };                                                                                                            \
+            constexpr auto literal = ::testing::detail::is_string_literal(#NAME);                                         \
+            using name_t = typename ::testing::detail::make_string<should_string, literal ? sizeof(#NAME) - 3 : 0>::type; \
+            using test_t = std::decay_t<decltype(*test)>;                                                                 \
+            return ::testing::detail::should_registrar<test_t, std::conditional_t<literal, name_t, void>, __LINE__,       \
+                                                       DISABLED>::index;                                                  \
+          }(this)))
+
+#define GTEST_SHARED(...) tr_gtest.shared([&] { return __VA_ARGS__; })
+#define SHOULD(NAME) __SHOULD_IMPL(false, NAME)
+#define DISABLED_SHOULD(NAME) __SHOULD_IMPL(true, NAME)
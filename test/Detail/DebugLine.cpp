@@ -0,0 +1,109 @@
+//
+// Copyright (c) 2016-2017 Kris Jusiak (kris at jusiak dot net)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//
+#if defined(__linux__)
+#include "GUnit/Detail/DebugLine.h"
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <string>
+
+namespace testing {
+inline namespace v1 {
+namespace detail {
+
+template <class T>
+std::string bytes(T value) {
+  std::string result(sizeof(T), 0);
+  std::memcpy(&result[0], &value, sizeof(T));
+  return result;
+}
+
+const std::string standard_opcode_lengths = {0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1};
+
+std::string unit(std::uint16_t version, const std::string &header, const std::string &program) {
+  const auto unit = bytes(version) + header.substr(0, version >= 5 ? 2 : 0) +
+                    bytes<std::uint32_t>(header.size() - (version >= 5 ? 2 : 0)) + header.substr(version >= 5 ? 2 : 0) +
+                    program;
+  return bytes<std::uint32_t>(unit.size()) + unit;
+}
+
+std::string set_address(std::uint64_t addr) { return std::string{"\0\x09\x02", 3} + bytes(addr); }
+const std::string end_sequence{"\0\x01\x01", 3};
+
+TEST(DebugLine, ShouldResolveEmptyTable) {
+  EXPECT_TRUE(line_table{}.empty());
+  EXPECT_EQ(std::make_pair(std::string{}, 0), line_table{}(0x1000));
+}
+
+TEST(DebugLine, ShouldResolveVersion4) {
+  // clang-format off
+  const auto header = std::string{1, 1, 1, '\xfb', 14, 13} + standard_opcode_lengths +
+                      std::string{"/src\0\0", 6} +
+                      std::string{"a.cpp\0\1\0\0", 9} + std::string{"/abs/b.h\0\0\0\0", 12} + std::string(1, 0);
+  const auto program = set_address(0x1000) +
+                       std::string{"\x03\x09\x01", 3} + // advance_line(9), copy
+                       std::string{"\x4b", 1} +         // special(address + 4, line + 1)
+                       std::string{"\x04\x02\x02\x08\x01", 5} + // set_file(2), advance_pc(8), copy
+                       std::string{"\x02\x04", 2} + end_sequence;
+  // clang-format on
+  const auto data = unit(4, header, program);
+  const line_table table{section{data.data(), data.size()}};
+
+  EXPECT_FALSE(table.empty());
+  EXPECT_EQ(std::make_pair(std::string{}, 0), table(0x0fff));
+  EXPECT_EQ(std::make_pair(std::string{"/src/a.cpp"}, 10), table(0x1000));
+  EXPECT_EQ(std::make_pair(std::string{"/src/a.cpp"}, 10), table(0x1003));
+  EXPECT_EQ(std::make_pair(std::string{"/src/a.cpp"}, 11), table(0x1004));
+  EXPECT_EQ(std::make_pair(std::string{"/abs/b.h"}, 11), table(0x100f));
+  EXPECT_EQ(std::make_pair(std::string{}, 0), table(0x1010));
+}
+
+TEST(DebugLine, ShouldResolveVersion5) {
+  const std::string line_str{"main.cpp\0x.h\0", 13};
+  // clang-format off
+  const auto header = std::string{8, 0, 1, 1, 1, '\xfb', 14, 13} + standard_opcode_lengths +
+                      std::string{"\x01\x01\x08\x02/comp\0/inc\0", 15} +                             // directories
+                      std::string{"\x02\x01\x1f\x02\x0b\x02", 6} + bytes<std::uint32_t>(0) + '\0' +  // files
+                      bytes<std::uint32_t>(9) + '\1';
+  const auto program = set_address(0x2000) +
+                       std::string{"\x04\x00\x03\x04\x01", 5} + // set_file(0), advance_line(4), copy
+                       std::string{"\x02\x02\x04\x01\x01", 5} + // advance_pc(2), set_file(1), copy
+                       std::string{"\x02\x02", 2} + end_sequence;
+  // clang-format on
+  const auto data = unit(5, header, program);
+  const line_table table{section{data.data(), data.size()}, section{line_str.data(), line_str.size()}};
+
+  EXPECT_EQ(std::make_pair(std::string{"/comp/main.cpp"}, 5), table(0x2000));
+  EXPECT_EQ(std::make_pair(std::string{"/inc/x.h"}, 5), table(0x2003));
+  EXPECT_EQ(std::make_pair(std::string{}, 0), table(0x2004));
+}
+
+TEST(DebugLine, ShouldIgnoreTruncatedTable) {
+  const auto header = std::string{1, 1, 1, '\xfb', 14, 13} + standard_opcode_lengths + std::string{"\0a.cpp\0\0\0\0\0", 11};
+  const auto data = unit(4, header, set_address(0x1000) + std::string{"\x01\x02\x04", 3} + end_sequence);
+  for (auto size = 0u; size < data.size(); ++size) {
+    const line_table table{section{data.data(), size}};
+    EXPECT_EQ(std::make_pair(std::string{}, 0), table(0x0fff));
+  }
+}
+
+__attribute__((noinline)) void *return_address() { return __builtin_return_address(0); }
+
+TEST(DebugLine, ShouldResolveOwnAddress) {
+  const auto line = __LINE__ + 1;
+  const auto pc = return_address();
+  const auto location = debug_line(static_cast<char *>(pc) - 1);
+  if (!location.first.empty()) {  // built with debug information
+    EXPECT_THAT(location.first, EndsWith("DebugLine.cpp"));
+    EXPECT_EQ(line, location.second);
+  }
+}
+
+}  // detail
+}  // v1
+}  // testing
+#endif
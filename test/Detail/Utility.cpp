@@ -8,6 +8,8 @@
 #include "GUnit/Detail/Utility.h"
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <array>
+#include <vector>
 
 struct a {};
 
@@ -44,6 +46,19 @@ TEST(Utility, ShouldMakeString) {
   static_assert(std::is_same<string<'a', 'b', 'c', 'd', 0>, decltype(make_string<String, sizeof("abcd")>::type())>::value, "");
 }
 
+#define STRING_10 "0123456789"
+#define STRING_100 STRING_10 STRING_10 STRING_10 STRING_10 STRING_10 STRING_10 STRING_10 STRING_10 STRING_10 STRING_10
+#define STRING_1000 STRING_100 STRING_100 STRING_100 STRING_100 STRING_100 STRING_100 STRING_100 STRING_100 STRING_100 STRING_100
+
+TEST(Utility, ShouldMakeLongString) {
+  struct String {
+    const char* chrs = STRING_1000 STRING_1000;
+  };
+
+  using type = make_string<String, sizeof(STRING_1000 STRING_1000)>::type;
+  EXPECT_STREQ(STRING_1000 STRING_1000, type::c_str());
+}
+
 TEST(Utility, ShouldReturnTrueIfIsValid) {
   auto has_f = is_valid([](auto&& x) -> decltype(x.f()) {});
   struct a {
@@ -122,6 +137,88 @@ TEST(Utility, ShouldReturnCallStack) {
   EXPECT_THAT(call_stack("\n", 1, 1), testing::MatchesRegex(".*Utility_ShouldReturnCallStack_Test.*"));
   EXPECT_THAT(call_stack("\n", 1, 2), testing::MatchesRegex(".*Utility_ShouldReturnCallStack_Test.*"));
 }
+
+TEST(Utility, ShouldReturnCallStackFromAddresses) {
+  void* bt[2] = {};
+  const auto frames = backtrace(bt, 2);
+  EXPECT_EQ(std::string{}, call_stack(bt, frames, "\n", 0, 0));
+  EXPECT_THAT(call_stack(bt, frames, "\n", 0, 1), testing::MatchesRegex(".*Utility_ShouldReturnCallStackFromAddresses_Test.*"));
+}
+
+TEST(Utility, ShouldReturnSourceLine) {
+  char file[] = "/tmp/gunit_source_XXXXXX";
+  const auto fd = mkstemp(file);
+  ASSERT_NE(-1, fd);
+  const std::string content = "first\n\t  second  \r\n\nlast";
+  ASSERT_EQ(ssize_t(content.size()), write(fd, content.data(), content.size()));
+  close(fd);
+
+  EXPECT_EQ("first", source_line(file, 1).str());
+  EXPECT_EQ("second", source_line(file, 2).str());
+  EXPECT_TRUE(source_line(file, 3).empty());
+  EXPECT_EQ("last", source_line(file, 4).str());
+  EXPECT_TRUE(source_line(file, 0).empty());
+  EXPECT_TRUE(source_line(file, 5).empty());
+  EXPECT_EQ(source_line(file, 2).data(), source_line(file, 2).data());
+
+  unlink(file);
+  EXPECT_EQ("last", source_line(file, 4).str());
+  EXPECT_TRUE(source_line("unknown", 1).empty());
+}
+
+__attribute__((noinline)) int backtrace_from_caller(void** bt) { return backtrace_from(__builtin_return_address(0), bt, 1); }
+
+TEST(Utility, ShouldReturnCallStackFromReturnAddress) {
+  void* bt[1] = {};
+  const auto frames = backtrace_from_caller(bt);
+  EXPECT_EQ(1, frames);
+  EXPECT_THAT(call_stack(bt, frames, "\n"), testing::MatchesRegex(".*Utility_ShouldReturnCallStackFromReturnAddress_Test.*"));
+}
+
+TEST(Utility, ShouldResolveAddressesInOrder) {
+  EXPECT_TRUE(addr2line(std::vector<void*>{}).empty());
+  void* addr = nullptr;
+  backtrace(&addr, 1);
+  const auto lines = addr2line(std::vector<void*>{addr, addr});
+  ASSERT_EQ(2u, lines.size());
+  EXPECT_EQ(lines[0], lines[1]);
+  EXPECT_EQ(lines[0], addr2line(addr));
+}
+
+TEST(Utility, ShouldAllocateAlignedMemoryFromArena) {
+  arena a{64};
+  auto *c = a.make<char>('c');
+  auto *d = a.make<double>(4.2);
+  auto *big = a.make<std::array<int, 100>>();
+  auto *i = a.make<int>(42);
+
+  EXPECT_EQ('c', *c);
+  EXPECT_EQ(4.2, *d);
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(d) % alignof(double));
+  EXPECT_EQ(100u, big->size());
+  EXPECT_EQ(42, *i);
+}
+
+TEST(Utility, ShouldDestroyArenaObjectsInReverseOrder) {
+  struct object {
+    object(std::vector<int> &destroyed, int id) : destroyed(destroyed), id(id) {}
+    ~object() { destroyed.push_back(id); }
+    std::vector<int> &destroyed;
+    int id;
+  };
+
+  std::vector<int> destroyed;
+  {
+    arena a{};
+    a.make<object>(destroyed, 1);
+    a.make<object>(destroyed, 2);
+    a.reset();
+    EXPECT_EQ((std::vector<int>{2, 1}), destroyed);
+
+    a.make<object>(destroyed, 3);
+  }
+  EXPECT_EQ((std::vector<int>{2, 1, 3}), destroyed);
+}
 }
 }
 }
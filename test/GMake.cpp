@@ -7,6 +7,9 @@
 //
 #include "GUnit/GMake.h"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <vector>
 #include "GUnit/GMock.h"
 #include "GUnit/GTest.h"
 
@@ -139,6 +142,23 @@ TEST(GMake, ShouldMakeUniquePtrInPlaceExampleUsingMake) {
   make<up_example>(std::make_unique<GMock<interface>>(), std::make_unique<GMock<interface2>>());
 }
 
+TEST(GMake, ShouldStoreMocksByType) {
+  using namespace testing;
+  mocks_t mocks;
+  EXPECT_TRUE(mocks.empty());
+
+  mocks.add<StrictGMock<interface2>>();
+  mocks.add<GMock<interface>>();
+  EXPECT_FALSE(mocks.emplace(detail::type_id<interface>(), std::make_shared<GMock<interface>>()).second);
+  EXPECT_EQ(2u, mocks.size());
+  EXPECT_TRUE(std::is_sorted(mocks.begin(), mocks.end()));
+
+  EXPECT_TRUE(mocks.get<interface>().get());
+  EXPECT_EQ(mocks.get<interface2>().get(), mocks.find(detail::type_id<interface2>())->second.get());
+  EXPECT_TRUE(mocks.find(detail::type_id<interface4>()) == mocks.end());
+  EXPECT_THROW(mocks.mock<interface4>(), mock_exception<interface4>);
+}
+
 TEST(GMake, ShouldMakeUsingAutoMocksInjection) {
   using namespace testing;
   mocks_t mocks;
@@ -164,6 +184,17 @@ struct by_value {
   by_value(int) {}
 };
 
+TEST(GMake, ShouldMakeUsingAutoStubsInjection) {
+  using namespace testing;
+  mocks_t mocks;
+  std::unique_ptr<example> sut;
+  std::tie(sut, mocks) = make<std::unique_ptr<example>, StubGMock>();
+  EXPECT_EQ(2u, mocks.size());
+
+  EXPECT_CALL(mocks.mock<interface2>(), (f2)(0));
+  sut->update();
+}
+
 TEST(GMake, ShouldMakeAndTryByValueIfRefIsNotProvided) {
   using namespace testing;
   mocks_t mocks;
@@ -184,6 +215,65 @@ TEST(GMake, ShouldMakeAndTryByValueConstIfRefIsNotProvided) {
   EXPECT_EQ(0u, mocks.size());
 }
 
+TEST(GMake, ShouldMakeMocksInSingleBlock) {
+  using namespace testing;
+  using T = std::unique_ptr<complex_example>;
+  detail::make<T, StrictGMock>(std::true_type{});  // records the footprint
+  auto made = detail::make<T, StrictGMock>(std::true_type{});
+  auto& sut = made.first;
+  auto& mocks = made.second;
+  ASSERT_EQ(4u, mocks.size());
+
+  const auto& block = mocks.begin()->second;
+  std::vector<const char*> objects;
+  for (const auto& mock : mocks) {
+    EXPECT_FALSE(mock.second.owner_before(block) || block.owner_before(mock.second));
+    objects.push_back(static_cast<const char*>(mock.second.get()));
+  }
+  const auto minmax = std::minmax_element(objects.begin(), objects.end());
+  EXPECT_LT(std::size_t(*minmax.second - *minmax.first), (detail::make_block::footprint<StrictGMock<interface_dtor>>() * 4));
+
+  EXPECT_CALL(mocks.mock<interface>(), (get)(42)).WillOnce(Return(0));
+  EXPECT_CALL(mocks.mock<interface2>(), (f1)(77.0));
+  EXPECT_CALL(mocks.mock<interface4>(), (f2)(arg{}));
+  EXPECT_CALL(mocks.mock<interface_dtor>(), (get)(0));
+  sut->update();
+}
+
+std::string destroyed;
+template <char Name>
+struct destroy_logger {
+  ~destroy_logger() { destroyed += Name; }
+};
+
+TEST(GMake, ShouldDestroyMocksOfBlockInReverseOrderWithTheLastOne) {
+  using namespace testing;
+  destroyed.clear();
+  std::shared_ptr<destroy_logger<'c'>> last;
+  {
+    detail::make_scope scope{detail::make_shared_block(3 * detail::make_block::footprint<destroy_logger<'a'>>())};
+    const auto a = detail::make_scope::make<destroy_logger<'a'>>();
+    const auto b = detail::make_scope::make<destroy_logger<'b'>>();
+    last = detail::make_scope::make<destroy_logger<'c'>>();
+    EXPECT_EQ(3 * detail::make_block::footprint<destroy_logger<'a'>>(), scope.footprint);
+  }
+  EXPECT_EQ("", destroyed);
+
+  last.reset();
+  EXPECT_EQ("cba", destroyed);
+}
+
+TEST(GMake, ShouldMakeMocksWhichDontFitIntoBlockSeparately) {
+  using namespace testing;
+  const auto block = detail::make_shared_block(0);
+  detail::make_scope scope{block};
+  const auto mock = detail::make_scope::make<StrictGMock<interface>>();
+  EXPECT_FALSE(block->contains(mock.get()));
+
+  EXPECT_CALL(*mock, (foo)(42));
+  mock->object().foo(42);
+}
+
 // clang-format off
 #if __has_include(<boost/di.hpp>)
 // clang-format on
@@ -7,8 +7,11 @@
 //
 #include "GUnit/GMock.h"
 #include <gtest/gtest.h>
+#include <gtest/gtest-spi.h>
 #include <memory>
 #include <stdexcept>
+#include <thread>
+#include <vector>
 
 struct interface {
   virtual ~interface() = default;
@@ -223,6 +226,225 @@ TEST(GMock, ShouldSetGetVtable) {
   EXPECT_EQ(expected, given);
 }
 
+TEST(GMock, ShouldShareVtableUntilSet) {
+  using namespace testing;
+  static const auto prototype = detail::vtable<interface>::shared(detail::union_cast<void*>(call), detail::union_cast<void*>(call));
+  EXPECT_TRUE(prototype.is_shared());
+
+  detail::vtable<interface> vt1{prototype};
+  detail::vtable<interface> vt2{prototype};
+  EXPECT_TRUE(vt1.is_shared());
+  EXPECT_TRUE(vt2.is_shared());
+
+  const auto expected = detail::union_cast<void*>(getn);
+  vt1.set(detail::offset(&interface::get), expected);
+  EXPECT_FALSE(vt1.is_shared());
+  EXPECT_TRUE(vt2.is_shared());
+  EXPECT_EQ(expected, vt1.get(detail::offset(&interface::get)));
+  EXPECT_EQ(detail::union_cast<void*>(call), vt2.get(detail::offset(&interface::get)));
+  EXPECT_EQ(detail::union_cast<void*>(call), prototype.get(detail::offset(&interface::get)));
+  EXPECT_EQ(detail::union_cast<void*>(call), vt1.get(detail::offset(&interface::foo)));
+}
+
+TEST(GMock, ShouldShareVtableBetweenMocksUntilFirstExpectation) {
+  using namespace testing;
+  GMock<interface> m1;
+  GMock<interface> m2;
+  EXPECT_EQ(reinterpret_cast<void*&>(m1), reinterpret_cast<void*&>(m2));
+
+  EXPECT_CALL(m1, (foo)(42));
+  EXPECT_NE(reinterpret_cast<void*&>(m1), reinterpret_cast<void*&>(m2));
+
+  m1.object().foo(42);
+}
+
+TEST(GMock, ShouldReplayConcurrentCalls) {
+  using namespace testing;
+  constexpr auto THREADS = 32;
+  constexpr auto CALLS = 1000;
+  ConcurrentGMock<interface> mock;
+
+  EXPECT_CALL(mock, (foo)(Lt(THREADS))).Times(THREADS * CALLS);
+  EXPECT_CALL(mock, (get)(_)).Times(THREADS);
+
+  std::vector<std::thread> threads;
+  for (auto i = 0; i < THREADS; ++i) {
+    threads.emplace_back([&mock, i] {
+      const interface& object = mock.object();
+      for (auto n = 0; n < CALLS; ++n) {
+        object.foo(i);
+      }
+      EXPECT_EQ(0, object.get(i));
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(std::size_t(THREADS * CALLS), mock.calls(&interface::foo));
+  EXPECT_EQ(std::size_t(THREADS), mock.calls(&interface::get));
+  EXPECT_EQ(0u, mock.calls(&interface::bar));
+}
+
+TEST(GMock, ShouldReplayConcurrentCallsOfMoreMocksThanCachedBuffers) {
+  using namespace testing;
+  constexpr auto MOCKS = 20;
+  constexpr auto CALLS = 10;
+  std::vector<std::unique_ptr<ConcurrentGMock<interface>>> mocks;
+  for (auto i = 0; i < MOCKS; ++i) {
+    mocks.push_back(std::make_unique<ConcurrentGMock<interface>>());
+    EXPECT_CALL(*mocks.back(), (foo)(i)).Times(CALLS);
+  }
+
+  std::thread thread{[&mocks] {
+    for (auto n = 0; n < CALLS; ++n) {
+      for (auto i = 0; i < MOCKS; ++i) {
+        mocks[i]->object().foo(i);
+      }
+    }
+  }};
+  thread.join();
+
+  for (auto& mock : mocks) {
+    mock->replay();
+  }
+}
+
+TEST(GMock, ShouldReplayConcurrentCallsInOrder) {
+  using namespace testing;
+  ConcurrentGMock<interface> mock;
+  const interface& object = mock.object();
+
+  {
+    InSequence sequence;
+    EXPECT_CALL(mock, (foo)(1));
+    EXPECT_CALL(mock, (foo)(2));
+    EXPECT_CALL(mock, (foo)(3));
+  }
+
+  object.foo(1);
+  std::thread{[&object] { object.foo(2); }}.join();
+  object.foo(3);
+
+  mock.replay();
+}
+
+TEST(GMock, ShouldReturnDefaultValueFromConcurrentCalls) {
+  using namespace testing;
+  DefaultValue<int>::Set(42);
+  {
+    ConcurrentGMock<interface> mock;
+    EXPECT_CALL(mock, (get)(1));
+    EXPECT_EQ(42, mock.object().get(1));
+    mock.replay();
+    EXPECT_EQ(1u, mock.calls(&interface::get));
+  }
+  DefaultValue<int>::Clear();
+}
+
+TEST(GMock, ShouldFailOnActionsOfConcurrentCalls) {
+  using namespace testing;
+  {
+    ConcurrentGMock<interface> mock;
+    EXPECT_CALL(mock, (get)(1)).WillOnce(Return(1));
+    EXPECT_EQ(0, mock.object().get(1));
+    EXPECT_NONFATAL_FAILURE(mock.replay(), "actions of get can't be run at call time");
+  }
+  {
+    ConcurrentGMock<interface> mock;
+    EXPECT_CALL(mock, (get)(_)).WillRepeatedly(Return(1));
+    EXPECT_EQ(0, mock.object().get(2));
+    EXPECT_NONFATAL_FAILURE(mock.replay(), "actions of get can't be run at call time");
+  }
+  {
+    ConcurrentGMock<interface> mock;
+    ON_CALL(mock, (get)(_)).WillByDefault(Return(1));
+    EXPECT_CALL(mock, (get)(_));
+    EXPECT_EQ(0, mock.object().get(3));
+    EXPECT_NONFATAL_FAILURE(mock.replay(), "actions of get can't be run at call time");
+  }
+}
+
+TEST(GMock, ShouldCountMockCallsOfAllThreads) {
+  using namespace testing;
+  constexpr auto THREADS = 4;
+  constexpr auto CALLS = 100;
+  const auto calls = detail::mock_calls::total();
+  {
+    ConcurrentGMock<interface> mock;
+    EXPECT_CALL(mock, (foo)(_)).Times(THREADS * CALLS + 1);
+    const interface& object = mock.object();
+    std::vector<std::thread> threads;
+    for (auto i = 0; i < THREADS; ++i) {
+      threads.emplace_back([&object] {
+        for (auto n = 0; n < CALLS; ++n) {
+          object.foo(n);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    object.foo(0);
+  }
+  EXPECT_EQ(std::size_t(THREADS * CALLS + 1), detail::mock_calls::total() - calls);
+}
+
+TEST(GMock, ShouldVerifySpiedCallsAfterTheFact) {
+  using namespace testing;
+  SpyGMock<interface> spy;
+  SPY(spy, (foo));
+  SPY(spy, (bar));
+  SPY(spy, (overload, void(int)));
+
+  const interface& object = spy.object();
+  for (auto i = 0; i < 100; ++i) {
+    object.foo(i);
+  }
+  object.bar(42, "str");
+  spy.object().overload(7);
+
+  EXPECT_CALLED(spy, (foo)(_)).Times(100);
+  EXPECT_CALLED(spy, (foo)(Lt(10))).Times(10);
+  EXPECT_CALLED(spy, (foo)(100)).Times(0);
+  EXPECT_CALLED(spy, (bar)(42, "str"));
+  EXPECT_CALLED(spy, (overload, void(int))(7)).Times(1);
+  EXPECT_EQ(102u, spy.history().size());
+  EXPECT_EQ(0u, spy.lost());
+}
+
+TEST(GMock, ShouldOverwriteOldestSpiedCalls) {
+  using namespace testing;
+  SpyGMock<interface> spy{10};
+  SPY(spy, (foo));
+
+  for (auto i = 0; i < 15; ++i) {
+    spy.object().foo(i);
+  }
+
+  EXPECT_EQ(10u, spy.capacity());
+  EXPECT_EQ(5u, spy.lost());
+  EXPECT_CALLED(spy, (foo)(_)).Times(10);
+  EXPECT_CALLED(spy, (foo)(Ge(5))).Times(10);
+}
+
+TEST(GMock, ShouldDiscardNewestSpiedCalls) {
+  using namespace testing;
+  SpyGMock<interface> spy{10, SpyOverflow::Discard};
+  SPY(spy, (foo));
+
+  for (auto i = 0; i < 15; ++i) {
+    spy.object().foo(i);
+  }
+
+  EXPECT_EQ(5u, spy.lost());
+  EXPECT_CALLED(spy, (foo)(Lt(10))).Times(10);
+
+  spy.clear();
+  EXPECT_EQ(0u, spy.lost());
+  EXPECT_CALLED(spy, (foo)(_)).Times(0);
+}
+
 TEST(GMock, ShouldBeConvertible) {
   using namespace testing;
   GMock<interface> m;
@@ -515,6 +737,138 @@ TEST(GMock, ShouldHandleMissingExpectations) {
   static_cast<interface_dtor&>(m).get(0);
 }
 
+TEST(GMock, ShouldFailOnEveryUninterestingCallOfStrictGMock) {
+  using namespace testing;
+  StrictGMock<interface> m;
+  const interface& i = m.object();
+
+  for (auto n = 0; n < 2; ++n) {
+    EXPECT_NONFATAL_FAILURE(i.foo(42), "[slot 3]");
+  }
+}
+
+TEST(GMock, ShouldWarnOnceAboutUninterestingCallsFromTheSameCallSite) {
+  using namespace testing;
+  NaggyGMock<interface> m;
+  const interface& i = m.object();
+
+  internal::CaptureStdout();
+  for (auto n = 0; n < 1000; ++n) {
+    i.foo(n);
+  }
+  const auto output = internal::GetCapturedStdout();
+
+  const auto warning = output.find("Uninteresting mock function call");
+  EXPECT_NE(std::string::npos, warning);
+  EXPECT_EQ(std::string::npos, output.find("Uninteresting mock function call", warning + 1));
+}
+
+TEST(GMock, ShouldIgnoreUninterestingCallsOfNiceGMock) {
+  using namespace testing;
+  NiceGMock<interface> m;
+  const interface& i = m.object();
+
+  for (auto n = 0; n < 1000; ++n) {
+    EXPECT_EQ(0, i.get(n));
+  }
+}
+
+TEST(GMock, ShouldReactOnUninterestingCallsAsChangedDuringTheTest) {
+  using namespace testing;
+  NaggyGMock<interface> m;
+  const interface& i = m.object();
+
+  internal::CaptureStdout();
+  i.foo(42);
+  EXPECT_NE(std::string::npos, internal::GetCapturedStdout().find("Uninteresting mock function call"));
+
+  detail::set_call_reaction(&m, internal::CallReaction::kFail);
+  EXPECT_NONFATAL_FAILURE(i.foo(42), "[slot 3]");
+
+  detail::set_call_reaction(&m, internal::CallReaction::kAllow);
+  internal::CaptureStdout();
+  i.foo(42);
+  EXPECT_EQ("", internal::GetCapturedStdout());
+
+  detail::unregister_call_reaction(&m);
+}
+
+TEST(GMock, ShouldReactOnUninterestingCallsAsSetThroughGMockBeforeTheFirstCall) {
+  using namespace testing;
+  NaggyGMock<interface> m;
+  const interface& i = m.object();
+
+  detail::SetCallReaction(&m, internal::CallReaction::kFail);  // gmock's setter, the epoch isn't changed
+  EXPECT_NONFATAL_FAILURE(i.foo(42), "[slot 3]");
+
+  detail::set_call_reaction(&m, internal::CallReaction::kAllow);
+  internal::CaptureStdout();
+  i.foo(42);
+  EXPECT_EQ("", internal::GetCapturedStdout());
+
+  detail::unregister_call_reaction(&m);
+}
+
+struct interface_stub {
+  struct point {
+    double x, y;
+  };
+
+  virtual ~interface_stub() = default;
+  virtual double get() const = 0;
+  virtual const char* ptr() = 0;
+  virtual std::string str() const = 0;
+  virtual std::pair<long, long> range() const = 0;
+  virtual point position() const = 0;
+};
+
+TEST(GMock, ShouldReturnZeroFromStubGMock) {
+  using namespace testing;
+  StubGMock<interface> m;
+  const interface& i = m.object();
+
+  for (auto n = 0; n < 1000; ++n) {
+    EXPECT_EQ(0, i.get(n));
+    i.foo(n);
+  }
+}
+
+TEST(GMock, ShouldReturnDefaultValuesFromStubbedMethods) {
+  using namespace testing;
+  StubGMock<interface_stub> m;
+  STUB(m, (str));
+  interface_stub& i = m.object();
+
+  EXPECT_EQ(0., static_cast<const interface_stub&>(i).get());
+  EXPECT_EQ(nullptr, i.ptr());
+  EXPECT_EQ("", i.str());
+}
+
+TEST(GMock, ShouldReturnZeroInAllResultRegistersFromStubGMock) {
+  using namespace testing;
+  StubGMock<interface_stub> m;
+  StubGMock<interface_stub> moved{std::move(m)};
+  const interface_stub& i = moved.object();
+
+  for (auto n = 1; n < 1000; ++n) {
+    EXPECT_EQ(std::make_pair(0l, 0l), i.range());
+    const auto position = i.position();
+    EXPECT_EQ(0., position.x);
+    EXPECT_EQ(0., position.y);
+  }
+}
+
+TEST(GMock, ShouldHandleExpectationsOfStubGMock) {
+  using namespace testing;
+  StubGMock<interface> m;
+  const interface& i = m.object();
+
+  EXPECT_CALL(m, (get)(42)).WillOnce(Return(87));
+
+  EXPECT_EQ(87, i.get(42));
+  i.foo(42);
+}
+
 TEST(GMock, ShouldNotTriggerUnexpectedCallForCtor) {
   using namespace testing;
   std::shared_ptr<void> mock = std::make_shared<GMock<interface>>();
@@ -648,6 +1002,38 @@ TEST(GMock, ShouldHandleON_CALLWithOverloadMethods) {
   EXPECT_EQ(87, static_cast<interface_overload_ret&>(m).f(42));
 }
 
+template <int>
+struct method_tag {};
+
+template <int N>
+struct interface_large : interface_large<N - 1> {
+  using interface_large<N - 1>::f;
+  virtual int f(method_tag<N>) = 0;
+};
+
+template <>
+struct interface_large<0> {
+  virtual int f(method_tag<0>) = 0;
+};
+
+struct interface_large_dtor : interface_large<300> {
+  virtual ~interface_large_dtor() = default;
+};
+
+TEST(GMock, ShouldMockInterfaceWithMoreThan128Methods) {
+  using namespace testing;
+  EXPECT_EQ(300u, detail::offset(static_cast<int (interface_large_dtor::*)(method_tag<300>)>(&interface_large_dtor::f)));
+  EXPECT_EQ(301u, detail::dtor_offset<interface_large_dtor>());
+  EXPECT_EQ(303u, detail::vtable_size<interface_large_dtor>());
+
+  GMock<interface_large_dtor> mock;
+  EXPECT_CALL(mock, (f, int(method_tag<300>))(_)).WillOnce(Return(300));
+  EXPECT_CALL(mock, (f, int(method_tag<150>))(_)).WillOnce(Return(150));
+
+  EXPECT_EQ(300, mock.object().f(method_tag<300>{}));
+  EXPECT_EQ(150, mock.object().f(method_tag<150>{}));
+}
+
 struct polymorphic_type {
   virtual void foo1() {}
   virtual bool foo2(int) { return true; }
@@ -6,8 +6,11 @@
 // http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "GUnit/GTest.h"
+#include <csignal>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
 
 TEST(GTest, ShouldCompareTypeId) {
   using namespace testing::detail;
@@ -60,6 +63,14 @@ TEST(GTest, ShouldReturnCtorSize) {
     };
     static_assert(3 == ctor_size<c>::value, "");
   }
+
+  {
+    struct c {
+      c(int) {}
+      c(int, int&, int*, const int&, int) {}
+    };
+    static_assert(5 == ctor_size<c>::value, "");
+  }
 }
 
 struct interface {
@@ -565,6 +576,111 @@ TEST_F(ComplexNiceMocksTest, ShouldMakeComplexExampleWithNiceMocks) {
   sut->update();
 }
 
+class counted_example {
+ public:
+  explicit counted_example(interface& i) : i(i) { ++count(); }
+
+  void update() { i.foo(42); }
+
+  static int& count() {
+    static int count = 0;
+    return count;
+  }
+
+ private:
+  interface& i;
+};
+
+struct counted_reset {
+  counted_reset() { counted_example::count() = 0; }
+};
+
+struct LazyTest : counted_reset, testing::GTest<counted_example> {};
+
+TEST_F(LazyTest, ShouldMakeSutAndMocksOnFirstAccess) {
+  using namespace testing;
+
+  EXPECT_EQ(0, counted_example::count());
+  EXPECT_TRUE(nullptr != sut);
+  EXPECT_EQ(1, counted_example::count());
+  EXPECT_EQ(1u, mocks.size());
+  EXPECT_EQ(1, counted_example::count());
+
+  EXPECT_CALL(mock<interface>(), (foo)(42)).Times(1);
+  sut->update();
+}
+
+TEST_F(LazyTest, ShouldMakeMocksOnFirstAccessOfAnyMember) {
+  using namespace testing;
+
+  EXPECT_EQ(0, counted_example::count());
+  EXPECT_TRUE(nullptr != mocks.get<interface>());
+  EXPECT_EQ(1, counted_example::count());
+  EXPECT_TRUE(mocks.find(detail::type_id<interface>()) != mocks.end());
+
+  mocks.add<NiceGMock<interface2>>();
+  EXPECT_EQ(2u, mocks.size());
+  mocks.clear();
+  EXPECT_TRUE(mocks.empty());
+  EXPECT_EQ(1, counted_example::count());
+}
+
+void update(const std::unique_ptr<counted_example>& sut) { sut->update(); }
+std::unique_ptr<counted_example> take(std::unique_ptr<counted_example>&& sut) { return std::move(sut); }
+void reset(std::unique_ptr<counted_example>& sut) { sut.reset(); }
+
+TEST_F(LazyTest, ShouldPassSutAsUniquePtr) {
+  using namespace testing;
+
+  EXPECT_CALL(mock<interface>(), (foo)(42)).Times(2);
+  update(sut);
+  EXPECT_EQ(1, counted_example::count());
+
+  const auto taken = take(std::move(sut));
+  EXPECT_TRUE(nullptr != taken);
+  EXPECT_TRUE(nullptr == sut);
+  taken->update();
+
+  sut = std::make_unique<counted_example>(mock<interface>().object());
+  reset(sut);
+  EXPECT_TRUE(nullptr == sut);
+  EXPECT_EQ(2, counted_example::count());
+}
+
+TEST_F(LazyTest, ShouldMoveSutOut) {
+  std::unique_ptr<counted_example> moved = std::move(sut);
+  EXPECT_TRUE(nullptr != moved);
+  EXPECT_TRUE(nullptr == sut);
+  EXPECT_EQ(1, counted_example::count());
+  EXPECT_EQ(1u, mocks.size());
+}
+
+struct LazyAssignTest : LazyTest {};
+
+TEST_F(LazyAssignTest, ShouldNotMakeDefaultSutAndMocksWhenAssigned) {
+  using namespace testing;
+
+  EXPECT_EQ(0, counted_example::count());
+  std::tie(sut, mocks) = make<SUT, NiceGMock>();
+  EXPECT_EQ(1, counted_example::count());
+  EXPECT_EQ(1u, mocks.size());
+
+  sut->update();
+  EXPECT_EQ(1, counted_example::count());
+}
+
+TEST_F(LazyAssignTest, ShouldNotMakeDefaultSutAndMocksWhenMocksAreAssigned) {
+  using namespace testing;
+
+  mocks_t other;
+  other.add<NiceGMock<interface>>();
+  mocks = other;
+
+  EXPECT_EQ(1u, mocks.size());
+  EXPECT_TRUE(nullptr == sut);
+  EXPECT_EQ(0, counted_example::count());
+}
+
 struct ComplexConstTest : testing::GTest<complex_example_const> {
   void SetUp() override { std::tie(sut, mocks) = testing::make<SUT, testing::NaggyGMock>(); }
 };
@@ -879,6 +995,354 @@ GTEST("TestDisabled6", "[]", testing::Values(1, 2, 3)) {
   DISABLED_SHOULD("b") {}
 }
 
+TEST(GTest, ShouldMatchPattern) {
+  using testing::detail::PatternMatchesString;
+  EXPECT_TRUE(PatternMatchesString("", ""));
+  EXPECT_FALSE(PatternMatchesString("", "a"));
+  EXPECT_TRUE(PatternMatchesString("*", ""));
+  EXPECT_TRUE(PatternMatchesString("a?c", "abc"));
+  EXPECT_FALSE(PatternMatchesString("a?c", "ac"));
+  EXPECT_TRUE(PatternMatchesString("a*c", "abbbc"));
+  EXPECT_TRUE(PatternMatchesString("*b*", "abc"));
+  EXPECT_FALSE(PatternMatchesString("*b*", "acd"));
+  EXPECT_TRUE(PatternMatchesString("a*b*c:x", "aXbYbZc"));
+  EXPECT_FALSE(PatternMatchesString("a:bc", "abc"));
+  EXPECT_TRUE(PatternMatchesString("**?", "a"));
+}
+
+TEST(GTest, ShouldMatchPatternWithManyWildcardsWithoutBacktracking) {
+  const std::string str(1000, 'a');
+  EXPECT_FALSE(testing::detail::PatternMatchesString("*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*b", str.c_str()));
+  EXPECT_TRUE(testing::detail::PatternMatchesString("*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*", str.c_str()));
+}
+
+TEST(GTest, ShouldMatchShouldFilter) {
+  using testing::detail::FilterMatchesShould;
+  EXPECT_TRUE(FilterMatchesShould("call foo", "*"));
+  EXPECT_TRUE(FilterMatchesShould("call foo", "call*"));
+  EXPECT_FALSE(FilterMatchesShould("call foo", "call bar"));
+  EXPECT_TRUE(FilterMatchesShould("call bar", "call foo:call bar"));
+  EXPECT_FALSE(FilterMatchesShould("call foo", "-call foo"));
+  EXPECT_TRUE(FilterMatchesShould("call bar", "-call foo"));
+  EXPECT_FALSE(FilterMatchesShould("call foo", "call*-*foo:*baz"));
+  EXPECT_TRUE(FilterMatchesShould("call bar", "call*-*foo:*baz"));
+  EXPECT_FALSE(FilterMatchesShould("call baz", "call*-*foo:*baz"));
+}
+
+TEST(GTest, ShouldRunEachShouldInForkedProcess) {
+  const auto parent = getpid();
+  auto prefix = 0;
+  auto shoulds = 0;
+  {
+    testing::detail::TestRun tr;
+    tr.once = false;
+    tr.fork = true;
+    ++prefix;
+    if (tr.run(false, "first", __LINE__)) {
+      EXPECT_NE(parent, getpid());
+      EXPECT_EQ(1, prefix);
+      ++shoulds;
+    }
+    if (tr.run(false, "second", __LINE__)) {
+      EXPECT_NE(parent, getpid());
+      EXPECT_EQ(0, shoulds);
+      ++shoulds;
+    }
+    EXPECT_FALSE(tr.once);
+  }
+  EXPECT_EQ(parent, getpid());
+  EXPECT_EQ(1, prefix);
+  EXPECT_EQ(0, shoulds);
+}
+
+void forked_should(void (*should)()) {
+  testing::detail::TestRun tr;
+  tr.once = false;
+  tr.fork = true;
+  if (tr.run(false, "forked", __LINE__)) {
+    should();
+  }
+}
+
+TEST(GTest, ShouldReportResultsOfForkedShould) {
+  EXPECT_NONFATAL_FAILURE(forked_should([] { EXPECT_TRUE(false) << "failed in child"; }), "failed in child");
+  EXPECT_NONFATAL_FAILURE(forked_should([] { _exit(3); }), "exited with code 3");
+  EXPECT_NONFATAL_FAILURE(forked_should([] { raise(SIGKILL); }), "terminated by signal");
+}
+
+TEST(GTest, ShouldRunShouldsInParallelAndReportThemInOrder) {
+  testing::TestPartResultArray results;
+  {
+    testing::ScopedFakeTestPartResultReporter reporter{testing::ScopedFakeTestPartResultReporter::INTERCEPT_ONLY_CURRENT_THREAD,
+                                                       &results};
+    testing::detail::TestRun tr;
+    tr.once = false;
+    tr.jobs = 3;
+    if (tr.run(false, "1", __LINE__)) {
+      usleep(100000);
+      ADD_FAILURE() << "1";
+    }
+    if (tr.run(false, "2", __LINE__)) {
+      ADD_FAILURE() << "2";
+    }
+    if (tr.run(false, "3", __LINE__)) {
+      ADD_FAILURE() << "3";
+    }
+    if (tr.run(false, "4", __LINE__)) {
+      _exit(4);
+    }
+  }
+
+  ASSERT_EQ(4, results.size());
+  EXPECT_THAT(results.GetTestPartResult(0).message(), testing::EndsWith("1"));
+  EXPECT_THAT(results.GetTestPartResult(1).message(), testing::EndsWith("2"));
+  EXPECT_THAT(results.GetTestPartResult(2).message(), testing::EndsWith("3"));
+  EXPECT_THAT(results.GetTestPartResult(3).message(), testing::EndsWith("\"4\" exited with code 4"));
+}
+
+TEST(GTest, ShouldRecordShouldsWithSanitizedNamesAsUniqueProperties) {
+  EXPECT_THAT(testing::detail::PropertyShouldReporter::Key("a b"), testing::StartsWith("should_a_b_"));
+  EXPECT_THAT(testing::detail::PropertyShouldReporter::Key("a-b"), testing::StartsWith("should_a_b_"));
+  EXPECT_NE(testing::detail::PropertyShouldReporter::Key("a b"), testing::detail::PropertyShouldReporter::Key("a-b"));
+
+  const auto output = testing::GTEST_FLAG(output);
+  testing::GTEST_FLAG(output) = "xml";
+  testing::detail::PropertyShouldReporter reporter;
+  testing::detail::ShouldResult result;
+  result.name = "a b";
+  reporter.OnShouldEnd(result);
+  result.name = "a-b";
+  reporter.OnShouldEnd(result);
+  testing::GTEST_FLAG(output) = output;
+
+  const auto& properties = *testing::UnitTest::GetInstance()->current_test_info()->result();
+  ASSERT_EQ(2, properties.test_property_count());
+  EXPECT_STREQ(testing::detail::PropertyShouldReporter::Key("a b").c_str(), properties.GetTestProperty(0).key());
+  EXPECT_STREQ(testing::detail::PropertyShouldReporter::Key("a-b").c_str(), properties.GetTestProperty(1).key());
+}
+
+struct should_recorder : testing::detail::ShouldReporter {
+  void OnShouldStart(const char* name) override { started.push_back(name); }
+  void OnShouldEnd(const testing::detail::ShouldResult& result) override { results.push_back(result); }
+
+  std::vector<std::string> started;
+  std::vector<testing::detail::ShouldResult> results;
+};
+
+TEST(GTest, ShouldReportShouldStatistics) {
+  should_recorder recorder;
+  {
+    testing::detail::TestRun tr;
+    tr.once = false;
+    tr.fork = false;
+    tr.jobs = 1;
+    tr.reporter = &recorder;
+    if (const auto should = tr.run(false, "call foo", __LINE__)) {
+      testing::GMock<interface> mock;
+      EXPECT_CALL(mock, (foo)(42)).Times(2);
+      static_cast<const interface&>(mock).foo(42);
+      static_cast<const interface&>(mock).foo(42);
+      EXPECT_EQ(0u, recorder.results.size());
+    }
+    EXPECT_TRUE(tr.once);
+  }
+
+  EXPECT_EQ(std::vector<std::string>{"call foo"}, recorder.started);
+  ASSERT_EQ(1u, recorder.results.size());
+  EXPECT_EQ("GTest.ShouldReportShouldStatistics", recorder.results[0].test);
+  EXPECT_EQ("call foo", recorder.results[0].name);
+  EXPECT_FALSE(recorder.results[0].failed);
+  EXPECT_EQ(2u, recorder.results[0].stats.mock_calls);
+  EXPECT_GE(recorder.results[0].stats.wall_time, 0.0);
+  EXPECT_GE(recorder.results[0].stats.cpu_time, 0.0);
+}
+
+TEST(GTest, ShouldReportStatisticsOfForkedShoulds) {
+  should_recorder recorder;
+  testing::TestPartResultArray failures;
+  {
+    testing::ScopedFakeTestPartResultReporter reporter{testing::ScopedFakeTestPartResultReporter::INTERCEPT_ONLY_CURRENT_THREAD,
+                                                       &failures};
+    testing::detail::TestRun tr;
+    tr.once = false;
+    tr.fork = true;
+    tr.jobs = 1;
+    tr.reporter = &recorder;
+    if (const auto should = tr.run(false, "call foo", __LINE__)) {
+      testing::GMock<interface> mock;
+      EXPECT_CALL(mock, (foo)(42));
+      static_cast<const interface&>(mock).foo(42);
+    }
+    if (const auto should = tr.run(false, "crash", __LINE__)) {
+      _exit(1);
+    }
+  }
+
+  EXPECT_EQ(1, failures.size());
+  ASSERT_EQ(2u, recorder.results.size());
+  EXPECT_EQ("call foo", recorder.results[0].name);
+  EXPECT_FALSE(recorder.results[0].failed);
+  EXPECT_EQ(1u, recorder.results[0].stats.mock_calls);
+  EXPECT_EQ("crash", recorder.results[1].name);
+  EXPECT_TRUE(recorder.results[1].failed);
+}
+
+GTEST("Manifest", "[Shoulds]") {
+  DISABLED_SHOULD("b") {}
+  SHOULD("a") {}
+}
+
+DISABLED_GTEST("ManifestDisabled") {
+  SHOULD("c") {}
+}
+
+TEST(GTest, ShouldRegisterShouldsInManifest) {
+  const auto& manifest = testing::detail::ShouldManifest::Instance();
+  const auto it = std::find_if(manifest.Tests().begin(), manifest.Tests().end(),
+                               [](const auto& test) { return test.suite == "Manifest"; });
+  ASSERT_TRUE(it != manifest.Tests().end());
+  EXPECT_EQ("[Shoulds]", it->name);
+  EXPECT_EQ(&*it, manifest.Find(it->file, it->line));
+  ASSERT_EQ(2u, it->shoulds.size());
+  EXPECT_STREQ("b", it->shoulds[0].name);
+  EXPECT_TRUE(it->shoulds[0].disabled);
+  EXPECT_STREQ("a", it->shoulds[1].name);
+  EXPECT_FALSE(it->shoulds[1].disabled);
+  EXPECT_EQ(it->shoulds[0].line + 1, it->shoulds[1].line);
+
+  std::stringstream list;
+  manifest.List(list, testing::detail::ShouldShard{}, false);
+  EXPECT_THAT(list.str(), testing::HasSubstr("Manifest.\n  [Shoulds]:b  # DISABLED "));
+  EXPECT_THAT(list.str(), testing::HasSubstr("\n  [Shoulds]:a  # "));
+  EXPECT_THAT(list.str(), testing::HasSubstr("DISABLED_ManifestDisabled.\n  :c  # "));
+}
+
+TEST(GTest, ShouldListShouldsOfShard) {
+  const auto& manifest = testing::detail::ShouldManifest::Instance();
+  const auto it = std::find_if(manifest.Tests().begin(), manifest.Tests().end(),
+                               [](const auto& test) { return test.suite == "Manifest"; });
+  ASSERT_TRUE(it != manifest.Tests().end());
+  ASSERT_EQ(2u, it->shoulds.size());
+
+  std::stringstream list[2];
+  manifest.List(list[0], testing::detail::ShouldShard{2, 0}, false);
+  manifest.List(list[1], testing::detail::ShouldShard{2, 1}, false);
+  const auto& b = list[it->shoulds[0].index % 2].str();
+  const auto& a = list[it->shoulds[1].index % 2].str();
+  EXPECT_THAT(b, testing::HasSubstr("  [Shoulds]:b  # DISABLED "));
+  EXPECT_THAT(list[(it->shoulds[0].index + 1) % 2].str(), testing::Not(testing::HasSubstr("  [Shoulds]:b  #")));
+  EXPECT_THAT(a, testing::HasSubstr("  [Shoulds]:a  # "));
+  EXPECT_THAT(list[(it->shoulds[1].index + 1) % 2].str(), testing::Not(testing::HasSubstr("  [Shoulds]:a  #")));
+}
+
+TEST(GTest, ShouldStopPassesAfterTheLastShould) {
+  const auto& manifest = testing::detail::ShouldManifest::Instance();
+  const auto it = std::find_if(manifest.Tests().begin(), manifest.Tests().end(),
+                               [](const auto& test) { return test.suite == "Manifest"; });
+  ASSERT_TRUE(it != manifest.Tests().end());
+
+  testing::detail::TestRun tr{&*it};
+  tr.shard = testing::detail::ShouldShard{};
+  auto passes = 0;
+  while (tr.next()) {
+    ++passes;
+    for (const auto& should : it->shoulds) {
+      tr.run(should.disabled, should.name, should.line, should.index);
+    }
+  }
+  EXPECT_EQ(1, passes);
+}
+
+GTEST("Passes", "[Shoulds]") {
+  auto& run = GTEST_SHARED(std::size_t{});  // SHOULDs of other shards don't take a pass
+  SHOULD("run in the first pass") { EXPECT_EQ(++run, tr_gtest.passes); }
+  SHOULD("run in the second pass") { EXPECT_EQ(++run, tr_gtest.passes); }
+  EXPECT_GE(2u, tr_gtest.passes);
+}
+
+GTEST("RuntimeNames", "[Shoulds]") {
+  const std::string name = "run with";
+  SHOULD("run in the first pass") { EXPECT_EQ(1u, tr_gtest.passes); }
+  SHOULD(name + " a name known at run time") { EXPECT_EQ(2u, tr_gtest.passes); }
+  SHOULD(name) { EXPECT_EQ(3u, tr_gtest.passes); }
+  EXPECT_GE(4u, tr_gtest.passes);
+}
+
+TEST(GTest, ShouldRunShouldsOfShardOnly) {
+  const auto& manifest = testing::detail::ShouldManifest::Instance();
+  const auto it = std::find_if(manifest.Tests().begin(), manifest.Tests().end(),
+                               [](const auto& test) { return test.suite == "Passes"; });
+  ASSERT_TRUE(it != manifest.Tests().end());
+  ASSERT_EQ(2u, it->shoulds.size());
+
+  for (const auto& selected : it->shoulds) {
+    testing::detail::TestRun tr{&*it};
+    tr.shard = testing::detail::ShouldShard{2, selected.index % 2};
+    std::vector<std::string> run;
+    while (tr.next()) {
+      for (const auto& should : it->shoulds) {
+        if (const auto section = tr.run(should.disabled, should.name, should.line, should.index)) {
+          run.push_back(should.name);
+        }
+      }
+    }
+    EXPECT_EQ(std::vector<std::string>{selected.name}, run);
+  }
+}
+
+TEST(GTest, ShouldNotRegisterShouldsNamedAtRunTime) {
+  EXPECT_TRUE(testing::detail::is_string_literal("\"a b\""));
+  EXPECT_FALSE(testing::detail::is_string_literal("name"));
+  EXPECT_FALSE(testing::detail::is_string_literal("\"a\" + b"));
+  EXPECT_FALSE(testing::detail::is_string_literal("\"a\\\"b\""));
+
+  const auto& manifest = testing::detail::ShouldManifest::Instance();
+  const auto it = std::find_if(manifest.Tests().begin(), manifest.Tests().end(),
+                               [](const auto& test) { return test.suite == "RuntimeNames"; });
+  ASSERT_TRUE(it != manifest.Tests().end());
+  EXPECT_TRUE(it->runtime_shoulds);
+  ASSERT_EQ(1u, it->shoulds.size());
+  EXPECT_STREQ("run in the first pass", it->shoulds[0].name);
+}
+
+TEST(GTest, ShouldMakeSharedObjectOnceAndDestroyItWithTestRun) {
+  std::weak_ptr<int> weak;
+  {
+    testing::detail::TestRun tr;
+    auto makes = 0;
+    const auto make = [&] {
+      ++makes;
+      return std::make_shared<int>(42);
+    };
+    auto& object = tr.shared(make);
+    weak = object;
+    EXPECT_EQ(&object, &tr.shared(make));
+    EXPECT_EQ(1, makes);
+    EXPECT_NE(&object, &tr.shared([] { return std::make_shared<int>(42); }));
+  }
+  EXPECT_TRUE(weak.expired());
+}
+
+std::vector<int> load_table(int& loads) {
+  ++loads;
+  return {1, 2, 3};
+}
+
+GTEST("Shared", "[Shoulds]") {
+  auto loads = 0;
+  const auto& table = GTEST_SHARED(load_table(loads));
+
+  SHOULD("load table in the first pass") {
+    EXPECT_EQ(1, loads);
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), table);
+  }
+
+  SHOULD("reuse table in the next pass") {
+    EXPECT_EQ(tr_gtest.passes == 1, loads);  // first pass if the other SHOULD is in another shard
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), table);
+  }
+}
+
 // clang-format off
 #if __has_include(<boost/di.hpp>)
 // clang-format on